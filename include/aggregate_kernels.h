@@ -0,0 +1,197 @@
+// cpp/include/aggregate_kernels.h
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+// Single-pass aggregation kernels over the amount/date/category columns.
+//
+// Each kernel has a portable scalar version and an AVX2 version; the
+// dispatching entry points pick AVX2 at runtime when the CPU supports it.
+// The AVX2 range kernel is fully vectorized (masked sum, count, min and max
+// in 64-bit lanes). The per-category kernel vectorizes the date predicate
+// eight rows at a time and skips blocks with no match, then scatters the
+// surviving rows into the per-category accumulators.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define EXPENSE_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define EXPENSE_TARGET_AVX2
+#else
+#define EXPENSE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Accumulators for one group of rows (amounts in cents)
+struct KernelStats {
+    int64_t sum = 0;
+    uint64_t count = 0;
+    int64_t min = INT64_MAX;
+    int64_t max = INT64_MIN;
+
+    void add(int64_t amount) {
+        sum += amount;
+        count++;
+        min = amount < min ? amount : min;
+        max = amount > max ? amount : max;
+    }
+
+    void merge(const KernelStats &o) {
+        sum += o.sum;
+        count += o.count;
+        min = o.min < min ? o.min : min;
+        max = o.max > max ? o.max : max;
+    }
+};
+
+// True if the running CPU (and OS) support AVX2
+inline bool cpuHasAvx2() {
+#if defined(EXPENSE_KERNELS_X86)
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+#else
+    return false;
+#endif
+}
+
+inline bool kernelsUseAvx2() {
+    static const bool avx2 = cpuHasAvx2();
+    return avx2;
+}
+
+// ---- scalar kernels ----
+
+// Stats over rows with from <= day <= to
+inline KernelStats aggregateRangeScalar(const int32_t *days, const int64_t *amounts,
+                                        size_t n, int32_t from, int32_t to) {
+    KernelStats s;
+    for (size_t i = 0; i < n; i++) {
+        if (days[i] >= from && days[i] <= to) s.add(amounts[i]);
+    }
+    return s;
+}
+
+// Per-category stats over rows with from <= day <= to (stats sized to the category count)
+inline void aggregateByCategoryScalar(const int32_t *days, const uint32_t *categories,
+                                      const int64_t *amounts, size_t n, int32_t from,
+                                      int32_t to, KernelStats *stats) {
+    for (size_t i = 0; i < n; i++) {
+        if (days[i] >= from && days[i] <= to) stats[categories[i]].add(amounts[i]);
+    }
+}
+
+// ---- AVX2 kernels ----
+#if defined(EXPENSE_KERNELS_X86)
+
+EXPENSE_TARGET_AVX2
+inline KernelStats aggregateRangeAvx2(const int32_t *days, const int64_t *amounts,
+                                      size_t n, int32_t from, int32_t to) {
+    // day > from - 1 && day < to + 1, compared in 64-bit lanes so the bounds cannot overflow
+    const __m256i lo = _mm256_set1_epi64x(static_cast<int64_t>(from) - 1);
+    const __m256i hi = _mm256_set1_epi64x(static_cast<int64_t>(to) + 1);
+    const __m256i maxSentinel = _mm256_set1_epi64x(INT64_MAX);
+    const __m256i minSentinel = _mm256_set1_epi64x(INT64_MIN);
+    __m256i vsum = _mm256_setzero_si256();
+    __m256i vcount = _mm256_setzero_si256();
+    __m256i vmin = maxSentinel;
+    __m256i vmax = minSentinel;
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i d = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(days + i)));
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(amounts + i));
+        __m256i m = _mm256_and_si256(_mm256_cmpgt_epi64(d, lo), _mm256_cmpgt_epi64(hi, d));
+        vsum = _mm256_add_epi64(vsum, _mm256_and_si256(a, m));
+        vcount = _mm256_sub_epi64(vcount, m); // matching lanes are -1
+        __m256i cmin = _mm256_blendv_epi8(maxSentinel, a, m);
+        vmin = _mm256_blendv_epi8(vmin, cmin, _mm256_cmpgt_epi64(vmin, cmin));
+        __m256i cmax = _mm256_blendv_epi8(minSentinel, a, m);
+        vmax = _mm256_blendv_epi8(vmax, cmax, _mm256_cmpgt_epi64(cmax, vmax));
+    }
+
+    alignas(32) int64_t sum[4], count[4], mins[4], maxs[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sum), vsum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(count), vcount);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), vmax);
+
+    KernelStats s = aggregateRangeScalar(days + i, amounts + i, n - i, from, to);
+    for (int l = 0; l < 4; l++) {
+        s.sum += sum[l];
+        s.count += static_cast<uint64_t>(count[l]);
+        s.min = mins[l] < s.min ? mins[l] : s.min;
+        s.max = maxs[l] > s.max ? maxs[l] : s.max;
+    }
+    return s;
+}
+
+EXPENSE_TARGET_AVX2
+inline void aggregateByCategoryAvx2(const int32_t *days, const uint32_t *categories,
+                                    const int64_t *amounts, size_t n, int32_t from,
+                                    int32_t to, KernelStats *stats) {
+    const __m256i vfrom = _mm256_set1_epi32(from);
+    const __m256i vto = _mm256_set1_epi32(to);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(days + i));
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(vfrom, d), _mm256_cmpgt_epi32(d, vto));
+        unsigned bits = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFFu;
+        if (bits == 0) continue;
+        if (bits == 0xFFu) {
+            for (size_t k = i; k < i + 8; k++) stats[categories[k]].add(amounts[k]);
+            continue;
+        }
+        while (bits) {
+#ifdef _MSC_VER
+            unsigned long lane;
+            _BitScanForward(&lane, bits);
+#else
+            unsigned lane = static_cast<unsigned>(__builtin_ctz(bits));
+#endif
+            stats[categories[i + lane]].add(amounts[i + lane]);
+            bits &= bits - 1;
+        }
+    }
+    aggregateByCategoryScalar(days + i, categories + i, amounts + i, n - i, from, to, stats);
+}
+
+#endif
+
+// ---- dispatch ----
+
+inline KernelStats aggregateRange(const int32_t *days, const int64_t *amounts,
+                                  size_t n, int32_t from, int32_t to) {
+#if defined(EXPENSE_KERNELS_X86)
+    if (kernelsUseAvx2()) return aggregateRangeAvx2(days, amounts, n, from, to);
+#endif
+    return aggregateRangeScalar(days, amounts, n, from, to);
+}
+
+inline std::vector<KernelStats> aggregateByCategory(const int32_t *days, const uint32_t *categories,
+                                                    const int64_t *amounts, size_t n,
+                                                    size_t categoryCount, int32_t from, int32_t to) {
+    std::vector<KernelStats> stats(categoryCount);
+#if defined(EXPENSE_KERNELS_X86)
+    if (kernelsUseAvx2()) {
+        aggregateByCategoryAvx2(days, categories, amounts, n, from, to, stats.data());
+        return stats;
+    }
+#endif
+    aggregateByCategoryScalar(days, categories, amounts, n, from, to, stats.data());
+    return stats;
+}
@@ -0,0 +1,85 @@
+// cpp/include/category_dictionary.h
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+// Interned category names. Each distinct name gets a dense code (0, 1, 2, ...)
+// so rows store a small integer, filters compare integers and summaries
+// accumulate into a flat array indexed by code.
+class CategoryDictionary {
+public:
+    using Code = uint32_t;
+    static constexpr Code kNotFound = UINT32_MAX;
+
+private:
+    std::deque<std::string> names;                        // stable addresses for the keys below
+    std::unordered_map<std::string_view, Code> codes;     // keys view into names
+    Code lastCode = kNotFound;                            // input is often grouped by category
+
+public:
+    CategoryDictionary() = default;
+
+    // The map keys point into names, so copies must rebuild them
+    CategoryDictionary(const CategoryDictionary &other) : names(other.names) {
+        rebuildIndex();
+    }
+
+    CategoryDictionary &operator=(const CategoryDictionary &other) {
+        if (this != &other) {
+            names = other.names;
+            rebuildIndex();
+        }
+        return *this;
+    }
+
+    CategoryDictionary(CategoryDictionary &&) = default;
+    CategoryDictionary &operator=(CategoryDictionary &&) = default;
+
+    size_t size() const { return names.size(); }
+    const std::string &name(Code code) const { return names[code]; }
+
+    void clear() {
+        names.clear();
+        codes.clear();
+        lastCode = kNotFound;
+    }
+
+    // Code for an existing name, or kNotFound
+    Code find(std::string_view name) const {
+        auto it = codes.find(name);
+        return it == codes.end() ? kNotFound : it->second;
+    }
+
+    // Code for a name, adding it if new
+    Code intern(std::string_view name) {
+        if (lastCode != kNotFound && names[lastCode] == name) return lastCode;
+        auto it = codes.find(name);
+        if (it != codes.end()) return lastCode = it->second;
+        Code code = static_cast<Code>(names.size());
+        names.emplace_back(name);
+        codes.emplace(names.back(), code);
+        return lastCode = code;
+    }
+
+    // Codes ordered by category name, for sorted output
+    std::vector<Code> sortedCodes() const {
+        std::vector<Code> order(names.size());
+        for (size_t c = 0; c < order.size(); c++) order[c] = static_cast<Code>(c);
+        std::sort(order.begin(), order.end(),
+                  [this](Code a, Code b) { return names[a] < names[b]; });
+        return order;
+    }
+
+private:
+    void rebuildIndex() {
+        codes.clear();
+        for (size_t c = 0; c < names.size(); c++)
+            codes.emplace(names[c], static_cast<Code>(c));
+        lastCode = kNotFound;
+    }
+};
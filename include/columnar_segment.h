@@ -0,0 +1,528 @@
+// cpp/include/columnar_segment.h
+#pragma once
+#include "expense_table.h"
+#include "expense_snapshot.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compressed column encoding of expense rows, for cold data that is written
+// once and read many times (sealed segments).
+//
+// Rows are cut into blocks of kBlockRows. A block stores its columns one
+// after another:
+//   dates         first day, then day-to-day deltas, as zigzag varints
+//   ids           if every id is one prefix plus a number ("E1042"): the
+//                 prefix once, then zigzag varint deltas of the numbers;
+//                 otherwise varint lengths, then the text
+//   categories    runs of (dictionary code, length) as varints, or the
+//                 codes bit-packed when that is smaller
+//   amounts       cents minus the block minimum, bit-packed at the width
+//                 of the block's range
+//   descriptions  varint lengths, then the text
+// Ledgers are mostly chronological, use a few dozen categories and issue
+// sequential ids, so dates and ids cost about a byte per row, categories
+// a few bytes per run and amounts 10-20 bits.
+//
+// A directory after the blocks keeps each block's rows, byte range,
+// checksum and min/max date and amount, so a scan skips every block that
+// cannot match a date or amount predicate without touching its bytes; only
+// the blocks that are decoded are verified.
+//
+// Layout (native little-endian):
+//   Header
+//   { uint32 length; char name[length]; } x categoryCount
+//   block bytes ...
+//   BlockInfo[blocks]   at header.directory
+class ColumnarSegment {
+public:
+    static constexpr char kMagic[8] = {'E', 'X', 'P', 'C', 'O', 'L', 'S', '\0'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kByteOrder = 0x01020304;
+    static constexpr size_t kBlockRows = 4096;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t rows;
+        uint64_t blocks;
+        uint64_t categoryCount;
+        uint64_t blocksStart;  // file offset of the first block (categories end there)
+        uint64_t directory;    // file offset of the block directory
+        uint64_t checksum;     // over the categories and the directory
+    };
+
+    struct BlockInfo {
+        uint64_t offset;       // file offset of the block
+        uint32_t bytes;
+        uint32_t rows;
+        int32_t minDay;
+        int32_t maxDay;
+        int64_t minAmount;     // cents
+        int64_t maxAmount;
+        uint64_t checksum;     // over the block's bytes
+    };
+
+    // Predicates whole blocks are skipped on (bounds inclusive)
+    struct Filter {
+        int32_t from = INT32_MIN;
+        int32_t to = INT32_MAX;
+        int64_t minAmount = INT64_MIN;   // cents
+        int64_t maxAmount = INT64_MAX;
+
+        bool mayMatch(const BlockInfo &b) const {
+            return b.maxDay >= from && b.minDay <= to && b.maxAmount >= minAmount && b.minAmount <= maxAmount;
+        }
+    };
+
+    // Write the given rows of table to path (via a temp file)
+    static bool write(const ExpenseTable &table, const std::vector<uint32_t> &rows,
+                      const std::string &path) {
+        std::string body;
+        for (size_t c = 0; c < table.dictionary.size(); c++) {
+            const std::string &name = table.dictionary.name(static_cast<uint32_t>(c));
+            uint32_t len = static_cast<uint32_t>(name.size());
+            body.append(reinterpret_cast<const char *>(&len), sizeof(len));
+            body.append(name);
+        }
+        size_t categoryBytes = body.size();
+        std::vector<BlockInfo> directory;
+        for (size_t first = 0; first < rows.size(); first += kBlockRows) {
+            size_t n = std::min(kBlockRows, rows.size() - first);
+            size_t start = body.size();
+            BlockInfo info;
+            info.offset = sizeof(Header) + start;
+            encodeBlock(table, rows.data() + first, n, body, info);
+            info.bytes = static_cast<uint32_t>(body.size() - start);
+            info.checksum = ExpenseSnapshot::checksum(body.data() + start, info.bytes);
+            directory.push_back(info);
+        }
+        body.resize((body.size() + 7) & ~size_t(7), '\0');
+
+        Header h;
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.byteOrder = kByteOrder;
+        h.rows = rows.size();
+        h.blocks = directory.size();
+        h.categoryCount = table.dictionary.size();
+        h.blocksStart = sizeof(Header) + categoryBytes;
+        h.directory = sizeof(Header) + body.size();
+        body.append(reinterpret_cast<const char *>(directory.data()), directory.size() * sizeof(BlockInfo));
+        h.checksum = ExpenseSnapshot::checksum(body.data() + (h.directory - sizeof(Header)),
+                                               directory.size() * sizeof(BlockInfo),
+                                               ExpenseSnapshot::checksum(body.data(), categoryBytes));
+
+        std::string tmpPath = path + ".tmp";
+        std::FILE *out = std::fopen(tmpPath.c_str(), "wb");
+        bool ok = out && std::fwrite(&h, sizeof(h), 1, out) == 1 &&
+                  std::fwrite(body.data(), 1, body.size(), out) == body.size();
+        ok = out && std::fclose(out) == 0 && ok;
+#ifdef _WIN32
+        if (ok) std::remove(path.c_str()); // rename() does not replace files on Windows
+#endif
+        if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            std::cerr << "Error: Could not write segment " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Decode the blocks filter may match, one at a time, calling
+    // fn(ExpenseTable &block) for each. The block table is reused, so its
+    // views are valid only during the call unless fn moves the rows out.
+    // Returns false if the file is missing, corrupt or from another version.
+    template <typename Fn>
+    static bool scan(const std::string &path, const Filter &filter, Fn &&fn) {
+        MappedFile file(path);
+        Header h;
+        if (!open(file, path, h)) return false;
+        std::vector<std::string_view> names;
+        if (!readCategories(file, h, names)) return false;
+        ExpenseTable block;
+        for (uint64_t b = 0; b < h.blocks; b++) {
+            BlockInfo info = blockInfo(file, h, b);
+            if (!filter.mayMatch(info)) continue;
+            if (!verify(file, h, info, path)) return false;
+            block.clear();
+            // Codes are the file's: intern its categories in order first
+            for (std::string_view name : names) block.dictionary.intern(name);
+            if (!decodeBlock(file.data() + info.offset, file.data() + info.offset + info.bytes, info, block))
+                return false;
+            fn(block);
+        }
+        return true;
+    }
+
+    // Append every row of the file to table; false (table unchanged) if it
+    // cannot be read
+    static bool read(ExpenseTable &table, const std::string &path) {
+        MappedFile file(path);
+        Header h;
+        if (!open(file, path, h)) return false;
+        // Blocks are decoded straight into one table with the file's
+        // dictionary, then moved over with a single category remap
+        ExpenseTable rows;
+        std::vector<std::string_view> names;
+        if (!readCategories(file, h, names)) return false;
+        for (std::string_view name : names) rows.dictionary.intern(name);
+        rows.reserve(static_cast<size_t>(h.rows));
+        for (uint64_t b = 0; b < h.blocks; b++) {
+            BlockInfo info = blockInfo(file, h, b);
+            if (!verify(file, h, info, path) ||
+                !decodeBlock(file.data() + info.offset, file.data() + info.offset + info.bytes, info, rows))
+                return false;
+        }
+        table.appendTable(std::move(rows));
+        return true;
+    }
+
+private:
+    static void putVarint(std::string &out, uint64_t v) {
+        while (v >= 0x80) {
+            out += static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+        out += static_cast<char>(v);
+    }
+
+    static bool getVarint(const char *&p, const char *end, uint64_t &v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t b = static_cast<uint8_t>(*p++);
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static constexpr char kRuns = 0;     // category column modes
+    static constexpr char kPacked = 1;
+
+    // Bits needed for values up to max
+    static int bitWidth(uint64_t max) {
+        int width = 0;
+        while (width < 64 && (max >> width) != 0) width++;
+        return width;
+    }
+
+    static size_t packedBytes(size_t n, int width) {
+        return (n * static_cast<size_t>(width) + 63) / 64 * sizeof(uint64_t);
+    }
+
+    // Append value(i) for i < n, width bits each, packed low bit first into
+    // 64-bit words (nothing for width 0)
+    template <typename Fn>
+    static void packBits(std::string &out, size_t n, int width, Fn &&value) {
+        if (width == 0) return;
+        std::vector<uint64_t> words(packedBytes(n, width) / sizeof(uint64_t), 0);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t v = value(i);
+            size_t bit = i * static_cast<size_t>(width);
+            words[bit >> 6] |= v << (bit & 63);
+            if ((bit & 63) + width > 64) words[(bit >> 6) + 1] |= v >> (64 - (bit & 63));
+        }
+        out.append(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+    }
+
+    // Call put(i, value) for n values packed by packBits at p, and advance
+    // p past them; false if they run past end
+    template <typename Fn>
+    static bool unpackBits(const char *&p, const char *end, size_t n, int width, Fn &&put) {
+        if (width > 64) return false;
+        if (width == 0) {
+            for (size_t i = 0; i < n; i++) put(i, 0);
+            return true;
+        }
+        size_t bytes = packedBytes(n, width);
+        if (bytes > static_cast<size_t>(end - p)) return false;
+        const char *packed = p;
+        auto word = [packed](size_t k) {
+            uint64_t w;
+            std::memcpy(&w, packed + k * sizeof(uint64_t), sizeof(w));
+            return w;
+        };
+        uint64_t mask = width == 64 ? ~0ull : (1ull << width) - 1;
+        for (size_t i = 0; i < n; i++) {
+            size_t bit = i * static_cast<size_t>(width);
+            uint64_t x = word(bit >> 6) >> (bit & 63);
+            if ((bit & 63) + width > 64) x |= word((bit >> 6) + 1) << (64 - (bit & 63));
+            put(i, x & mask);
+        }
+        p += bytes;
+        return true;
+    }
+
+    static uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    static int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    // Split id into a non-digit prefix and a decimal number without
+    // leading zeros; false if it has no such form
+    static bool splitNumbered(std::string_view id, std::string_view &prefix, uint64_t &number) {
+        size_t k = id.size();
+        while (k > 0 && id[k - 1] >= '0' && id[k - 1] <= '9') k--;
+        size_t digits = id.size() - k;
+        if (digits == 0 || digits > 18 || (digits > 1 && id[k] == '0')) return false;
+        prefix = id.substr(0, k);
+        number = 0;
+        for (size_t i = k; i < id.size(); i++) number = number * 10 + static_cast<uint64_t>(id[i] - '0');
+        return true;
+    }
+
+    static size_t digitCount(uint64_t v) {
+        size_t n = 1;
+        while (v >= 10) {
+            v /= 10;
+            n++;
+        }
+        return n;
+    }
+
+    static void encodeBlock(const ExpenseTable &t, const uint32_t *rows, size_t n,
+                            std::string &out, BlockInfo &info) {
+        // Date stats cover dated rows only: undated rows never match a
+        // bounded range, and an unbounded one takes every block
+        info.rows = static_cast<uint32_t>(n);
+        info.minDay = INT32_MAX;
+        info.maxDay = kNoDate;
+        info.minAmount = info.maxAmount = t.amounts[rows[0]];
+        for (size_t i = 0; i < n; i++) {
+            int32_t day = t.days[rows[i]];
+            if (day != kNoDate) {
+                info.minDay = std::min(info.minDay, day);
+                info.maxDay = std::max(info.maxDay, day);
+            }
+            info.minAmount = std::min(info.minAmount, t.amounts[rows[i]]);
+            info.maxAmount = std::max(info.maxAmount, t.amounts[rows[i]]);
+        }
+        if (info.maxDay == kNoDate) info.minDay = kNoDate;
+
+        int64_t prev = 0;
+        for (size_t i = 0; i < n; i++) {
+            putVarint(out, zigzag(static_cast<int64_t>(t.days[rows[i]]) - prev));
+            prev = t.days[rows[i]];
+        }
+
+        std::string_view prefix, p;
+        uint64_t number;
+        bool numbered = splitNumbered(t.id(rows[0]), prefix, number);
+        for (size_t i = 1; i < n && numbered; i++)
+            numbered = splitNumbered(t.id(rows[i]), p, number) && p == prefix;
+        out += static_cast<char>(numbered ? 1 : 0);
+        if (numbered) {
+            putVarint(out, prefix.size());
+            out.append(prefix);
+            prev = 0;
+            for (size_t i = 0; i < n; i++) {
+                splitNumbered(t.id(rows[i]), p, number);
+                putVarint(out, zigzag(static_cast<int64_t>(number) - prev));
+                prev = static_cast<int64_t>(number);
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) putVarint(out, t.id(rows[i]).size());
+            for (size_t i = 0; i < n; i++) out.append(t.id(rows[i]));
+        }
+
+        // Categories as runs, or as bit-packed codes when rows alternate
+        // too much for runs to pay off
+        std::string runs;
+        size_t runCount = 0;
+        uint32_t maxCode = 0;
+        for (size_t i = 0; i < n;) {
+            size_t j = i + 1;
+            while (j < n && t.categories[rows[j]] == t.categories[rows[i]]) j++;
+            putVarint(runs, t.categories[rows[i]]);
+            putVarint(runs, j - i);
+            maxCode = std::max(maxCode, t.categories[rows[i]]);
+            runCount++;
+            i = j;
+        }
+        int codeWidth = bitWidth(maxCode);
+        if (runs.size() <= packedBytes(n, codeWidth)) {
+            out += static_cast<char>(kRuns);
+            putVarint(out, runCount);
+            out += runs;
+        } else {
+            out += static_cast<char>(kPacked);
+            out += static_cast<char>(codeWidth);
+            packBits(out, n, codeWidth, [&](size_t i) { return t.categories[rows[i]]; });
+        }
+
+        int width = bitWidth(static_cast<uint64_t>(info.maxAmount) - static_cast<uint64_t>(info.minAmount));
+        out += static_cast<char>(width);
+        packBits(out, n, width, [&](size_t i) {
+            return static_cast<uint64_t>(t.amounts[rows[i]]) - static_cast<uint64_t>(info.minAmount);
+        });
+
+        for (size_t i = 0; i < n; i++) putVarint(out, t.description(rows[i]).size());
+        for (size_t i = 0; i < n; i++) out.append(t.description(rows[i]));
+    }
+
+    // Append the rows of one block to t, whose dictionary holds the file's
+    // categories in file order
+    static bool decodeBlock(const char *p, const char *end, const BlockInfo &info, ExpenseTable &t) {
+        size_t n = info.rows, base = t.size();
+        uint64_t v;
+        t.days.resize(base + n);
+        int32_t *days = t.days.data() + base;
+        int64_t day = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!getVarint(p, end, v)) return false;
+            day += unzigzag(v);
+            days[i] = static_cast<int32_t>(day);
+        }
+
+        // Ids: lengths now, text once the descriptions are known
+        if (p >= end) return false;
+        bool numbered = *p++ == 1;
+        std::string_view prefix;
+        std::vector<uint64_t> numbers;
+        const char *idText = nullptr;
+        t.idLength.resize(base + n);
+        uint32_t *idLength = t.idLength.data() + base;
+        if (numbered) {
+            if (!getVarint(p, end, v) || v > static_cast<uint64_t>(end - p)) return false;
+            prefix = std::string_view(p, static_cast<size_t>(v));
+            p += v;
+            numbers.resize(n);
+            int64_t number = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (!getVarint(p, end, v)) return false;
+                number += unzigzag(v);
+                numbers[i] = static_cast<uint64_t>(number);
+                idLength[i] = static_cast<uint32_t>(prefix.size() + digitCount(numbers[i]));
+            }
+        } else {
+            uint64_t total = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (!getVarint(p, end, v)) return false;
+                idLength[i] = static_cast<uint32_t>(v);
+                total += v;
+            }
+            if (total > static_cast<uint64_t>(end - p)) return false;
+            idText = p;
+            p += total;
+        }
+
+        if (p >= end) return false;
+        t.categories.resize(base + n);
+        uint32_t *categories = t.categories.data() + base;
+        uint64_t codes = t.dictionary.size();
+        if (*p++ == kRuns) {
+            uint64_t runs;
+            if (!getVarint(p, end, runs)) return false;
+            size_t filled = 0;
+            for (uint64_t r = 0; r < runs; r++) {
+                uint64_t code, length;
+                if (!getVarint(p, end, code) || !getVarint(p, end, length) ||
+                    code >= codes || length > n - filled) return false;
+                std::fill_n(categories + filled, static_cast<size_t>(length), static_cast<uint32_t>(code));
+                filled += static_cast<size_t>(length);
+            }
+            if (filled != n) return false;
+        } else {
+            bool valid = true;
+            if (p >= end || !unpackBits(p, end, n, static_cast<uint8_t>(*p++), [&](size_t i, uint64_t code) {
+                    valid &= code < codes;
+                    categories[i] = static_cast<uint32_t>(code);
+                }) || !valid) return false;
+        }
+
+        if (p >= end) return false;
+        int width = static_cast<uint8_t>(*p++);
+        t.amounts.resize(base + n);
+        int64_t *amounts = t.amounts.data() + base;
+        uint64_t minAmount = static_cast<uint64_t>(info.minAmount);
+        if (!unpackBits(p, end, n, width, [amounts, minAmount](size_t i, uint64_t x) {
+                amounts[i] = static_cast<int64_t>(minAmount + x);
+            })) return false;
+
+        // Descriptions, then all row text of the block in one arena block
+        t.textLength.resize(base + n);
+        uint32_t *textLength = t.textLength.data() + base;
+        uint64_t textBytes = 0, descBytes = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!getVarint(p, end, v) || v > UINT32_MAX - idLength[i]) return false;
+            textLength[i] = idLength[i] + static_cast<uint32_t>(v);
+            textBytes += textLength[i];
+            descBytes += v;
+        }
+        if (descBytes > static_cast<uint64_t>(end - p)) return false;
+        const char *descText = p;
+        char *text = t.arena.allocate(static_cast<size_t>(textBytes));
+        t.textPtr.resize(base + n);
+        const char **textPtr = t.textPtr.data() + base;
+        for (size_t i = 0; i < n; i++) {
+            size_t idLen = idLength[i], descLen = textLength[i] - idLen;
+            textPtr[i] = text;
+            if (numbered && i > 0 && numbers[i] == numbers[i - 1] + 1 && idLen == idLength[i - 1]) {
+                // Sequential ids: copy the previous one and add one in place
+                std::memcpy(text, textPtr[i - 1], idLen);
+                char *d = text + idLen;
+                while (*--d == '9') *d = '0';
+                ++*d;
+            } else if (numbered) {
+                std::memcpy(text, prefix.data(), prefix.size());
+                uint64_t number = numbers[i];
+                for (char *d = text + idLen; d > text + prefix.size(); number /= 10) *--d = char('0' + number % 10);
+            } else {
+                std::memcpy(text, idText, idLen);
+                idText += idLen;
+            }
+            std::memcpy(text + idLen, descText, descLen);
+            descText += descLen;
+            text += textLength[i];
+        }
+        return true;
+    }
+
+    static BlockInfo blockInfo(const MappedFile &file, const Header &h, uint64_t b) {
+        BlockInfo info;
+        std::memcpy(&info, file.data() + h.directory + b * sizeof(BlockInfo), sizeof(info));
+        return info;
+    }
+
+    // Check that a block lies inside the file and matches its checksum
+    static bool verify(const MappedFile &file, const Header &h, const BlockInfo &info, const std::string &path) {
+        if (info.offset < h.blocksStart || info.offset + info.bytes > h.directory) return false;
+        if (ExpenseSnapshot::checksum(file.data() + info.offset, info.bytes) == info.checksum) return true;
+        std::cerr << "Warning: segment " << path << " has a corrupt block.\n";
+        return false;
+    }
+
+    // Map and validate a segment file (header, categories and directory)
+    static bool open(const MappedFile &file, const std::string &path, Header &h) {
+        if (!file.isOpen() || file.size() < sizeof(Header)) return false;
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+            h.version != kVersion || h.byteOrder != kByteOrder) return false;
+        if (h.blocksStart < sizeof(Header) || h.blocksStart > h.directory || h.directory > file.size() ||
+            (file.size() - h.directory) / sizeof(BlockInfo) < h.blocks) return false;
+        uint64_t sum = ExpenseSnapshot::checksum(file.data() + sizeof(Header), h.blocksStart - sizeof(Header));
+        if (ExpenseSnapshot::checksum(file.data() + h.directory, h.blocks * sizeof(BlockInfo), sum) != h.checksum) {
+            std::cerr << "Warning: segment " << path << " is corrupt, ignoring it.\n";
+            return false;
+        }
+        return true;
+    }
+
+    static bool readCategories(const MappedFile &file, const Header &h, std::vector<std::string_view> &names) {
+        size_t pos = sizeof(Header);
+        for (uint64_t c = 0; c < h.categoryCount; c++) {
+            uint32_t len;
+            if (pos + sizeof(len) > h.blocksStart) return false;
+            std::memcpy(&len, file.data() + pos, sizeof(len));
+            pos += sizeof(len);
+            if (pos + len > h.blocksStart) return false;
+            names.emplace_back(file.data() + pos, len);
+            pos += len;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,93 @@
+// cpp/include/csv_scanner.h
+#pragma once
+#include <string_view>
+#include <cstring>
+#include <vector>
+#include "money.h"
+
+// Zero-copy view of one expense row: every field points into the source buffer
+struct CsvRow {
+    std::string_view id;
+    std::string_view date;
+    std::string_view amount;
+    std::string_view category;
+    std::string_view description; // rest of the line, may contain commas
+};
+
+// Cut the next comma-separated field off the front of rest
+inline std::string_view nextCsvField(std::string_view &rest) {
+    const void *comma = std::memchr(rest.data(), ',', rest.size());
+    if (!comma) {
+        std::string_view field = rest;
+        rest = std::string_view();
+        return field;
+    }
+    size_t n = static_cast<const char *>(comma) - rest.data();
+    std::string_view field = rest.substr(0, n);
+    rest.remove_prefix(n + 1);
+    return field;
+}
+
+// Split a line into id,date,amount,category,description.
+// Missing trailing fields are left empty.
+inline CsvRow splitCsvRow(std::string_view line) {
+    CsvRow row;
+    row.id = nextCsvField(line);
+    row.date = nextCsvField(line);
+    row.amount = nextCsvField(line);
+    row.category = nextCsvField(line);
+    row.description = line;
+    return row;
+}
+
+// Parse an amount the way std::stod would accept it (leading blanks, optional
+// sign, trailing garbage ignored). Anything unparseable becomes 0.00.
+inline Money parseCsvAmount(std::string_view s) {
+    Money value;
+    if (!Money::parse(s, value)) return Money();
+    return value;
+}
+
+// Call fn(line) for every non-empty line of a CSV buffer.
+// Lines are found with memchr, which the C runtime vectorizes.
+template <typename Fn>
+void forEachCsvLine(std::string_view data, Fn &&fn, bool skipHeader = true) {
+    const char *p = data.data();
+    const char *end = p + data.size();
+    bool header = skipHeader;
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *lineEnd = nl ? nl : end;
+        if (header) {
+            header = false;
+        } else if (lineEnd != p) {
+            fn(std::string_view(p, lineEnd - p));
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Split the body of a CSV buffer (after the header line) into at most n
+// byte ranges. Every range ends right after a newline (or at the end of the
+// buffer), so each one can be parsed independently with skipHeader = false.
+inline std::vector<std::string_view> splitCsvChunks(std::string_view data, size_t n) {
+    std::vector<std::string_view> chunks;
+    const void *nl = std::memchr(data.data(), '\n', data.size());
+    if (!nl) return chunks; // header only
+    const char *p = static_cast<const char *>(nl) + 1;
+    const char *end = data.data() + data.size();
+    if (n == 0) n = 1;
+    size_t target = (end - p) / n;
+
+    while (p < end) {
+        const char *cut = end;
+        if (chunks.size() + 1 < n && static_cast<size_t>(end - p) > target) {
+            const char *probe = p + target;
+            const void *next = std::memchr(probe, '\n', end - probe);
+            cut = next ? static_cast<const char *>(next) + 1 : end;
+        }
+        chunks.emplace_back(p, cut - p);
+        p = cut;
+    }
+    return chunks;
+}
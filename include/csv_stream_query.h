@@ -0,0 +1,144 @@
+// cpp/include/csv_stream_query.h
+#pragma once
+#include "csv_scanner.h"
+#include "date_util.h"
+#include "money.h"
+#include "category_dictionary.h"
+#include "aggregate_kernels.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Query a CSV ledger without loading it: the file is read through one
+// fixed-size buffer, and each line is checked field by field in order of
+// cost (date, then amount, then category) so rows that fail an early
+// predicate are never split further or copied. Memory use is the buffer
+// plus the aggregates, independent of the file size.
+class CsvStreamQuery {
+public:
+    int32_t from = INT32_MIN;          // day range (inclusive)
+    int32_t to = INT32_MAX;
+    bool hasMin = false, hasMax = false;
+    Money minAmount, maxAmount;        // amount range (inclusive)
+    std::vector<std::string> categories; // empty = any category, else any of these
+
+    // Rows that pass, with views valid only during the callback
+    struct Match {
+        CsvRow row;
+        int32_t day;
+        Money amount;
+        char dateText[10];     // row.date of a decoded row points here
+    };
+
+    static constexpr size_t kBufferSize = 4u << 20;
+
+    // Evaluate the predicates on one CSV line
+    bool matchLine(std::string_view line, Match &m) const {
+        std::string_view rest = line;
+        m.row.id = nextCsvField(rest);
+        m.row.date = nextCsvField(rest);
+        m.day = parseDate(m.row.date);
+        if (m.day < from || m.day > to) return false;
+        if (m.day == kNoDate && (from != INT32_MIN || to != INT32_MAX)) return false;
+
+        m.row.amount = nextCsvField(rest);
+        if (hasMin || hasMax) {
+            m.amount = parseCsvAmount(m.row.amount);
+            if ((hasMin && m.amount < minAmount) || (hasMax && m.amount > maxAmount)) return false;
+        }
+
+        m.row.category = nextCsvField(rest);
+        if (!matchCategory(m.row.category)) return false;
+
+        if (!hasMin && !hasMax) m.amount = parseCsvAmount(m.row.amount);
+        m.row.description = rest;
+        return true;
+    }
+
+    // True if name is one of the wanted categories (or any is wanted)
+    bool matchCategory(std::string_view name) const {
+        if (categories.empty()) return true;
+        for (const std::string &c : categories) {
+            if (name == c) return true;
+        }
+        return false;
+    }
+
+    // Same predicates on a row that is already decoded (e.g. from a
+    // columnar segment); row.amount is left empty
+    bool matchFields(std::string_view id, int32_t day, Money amount, std::string_view categoryName,
+                     std::string_view description, Match &m) const {
+        if (day < from || day > to) return false;
+        if (day == kNoDate && (from != INT32_MIN || to != INT32_MAX)) return false;
+        if ((hasMin && amount < minAmount) || (hasMax && amount > maxAmount)) return false;
+        if (!matchCategory(categoryName)) return false;
+        m.row.id = id;
+        m.row.date = std::string_view(m.dateText, static_cast<size_t>(formatDate(day, m.dateText) - m.dateText));
+        m.row.amount = std::string_view();
+        m.row.category = categoryName;
+        m.row.description = description;
+        m.day = day;
+        m.amount = amount;
+        return true;
+    }
+
+    // Stream path through the predicates, calling fn(const Match &) per hit.
+    // Returns false if the file cannot be read.
+    template <typename Fn>
+    bool scan(const std::string &path, Fn &&fn) const {
+        std::FILE *in = std::fopen(path.c_str(), "rb");
+        if (!in) return false;
+
+        std::vector<char> buf(kBufferSize);
+        size_t filled = 0;
+        bool header = true;
+        Match m;
+        while (true) {
+            size_t got = std::fread(buf.data() + filled, 1, buf.size() - filled, in);
+            filled += got;
+            bool eof = got == 0;
+
+            // Process every complete line; at EOF the remainder is the last line
+            const char *p = buf.data();
+            const char *end = buf.data() + filled;
+            while (p < end) {
+                const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                if (!nl && !eof) break;
+                const char *lineEnd = nl ? nl : end;
+                if (header) {
+                    header = false;
+                } else if (lineEnd != p && matchLine(std::string_view(p, lineEnd - p), m)) {
+                    fn(static_cast<const Match &>(m));
+                }
+                p = nl ? nl + 1 : end;
+            }
+            if (eof) break;
+
+            // Move the partial line to the front; grow only for a line longer than the buffer
+            size_t tail = end - p;
+            std::memmove(buf.data(), p, tail);
+            filled = tail;
+            if (filled == buf.size()) buf.resize(buf.size() * 2);
+        }
+        std::fclose(in);
+        return true;
+    }
+
+    // Per-category stats over the matching rows of path
+    struct Summary {
+        CategoryDictionary categories;
+        std::vector<KernelStats> stats;   // index = code in categories
+    };
+
+    bool summarize(const std::string &path, Summary &out) const {
+        return scan(path, [&out](const Match &m) { addTo(out, m); });
+    }
+
+    static void addTo(Summary &out, const Match &m) {
+        uint32_t code = out.categories.intern(m.row.category);
+        if (out.stats.size() <= code) out.stats.resize(code + 1);
+        out.stats[code].add(m.amount.raw());
+    }
+};
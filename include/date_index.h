@@ -0,0 +1,111 @@
+// cpp/include/date_index.h
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Row numbers ordered by (day, row) so a date range is two binary searches.
+//
+// Appends with a date at or after the latest one (the usual case) extend the
+// sorted run directly. Out-of-order appends go to a small sorted delta that
+// is merged into the main run once it grows past a fraction of the index,
+// which keeps inserts cheap without rebuilding the whole permutation.
+class DateIndex {
+private:
+    struct Entry {
+        int32_t day;
+        uint32_t row;
+        bool operator<(const Entry &o) const {
+            return day != o.day ? day < o.day : row < o.row;
+        }
+    };
+
+    std::vector<Entry> sorted;  // main run
+    std::vector<Entry> delta;   // late inserts, kept sorted
+
+    static constexpr size_t kMinDelta = 1024;
+
+    using Iter = std::vector<Entry>::const_iterator;
+
+    static Iter lowerBound(const std::vector<Entry> &run, int32_t from) {
+        return std::lower_bound(run.begin(), run.end(), Entry{from, 0});
+    }
+
+    static Iter upperBound(const std::vector<Entry> &run, int32_t to) {
+        return std::upper_bound(run.begin(), run.end(), Entry{to, UINT32_MAX});
+    }
+
+    void mergeDelta() {
+        size_t mid = sorted.size();
+        sorted.insert(sorted.end(), delta.begin(), delta.end());
+        std::inplace_merge(sorted.begin(), sorted.begin() + mid, sorted.end());
+        delta.clear();
+    }
+
+public:
+    void clear() {
+        sorted.clear();
+        delta.clear();
+    }
+
+    size_t size() const { return sorted.size() + delta.size(); }
+
+    // Rebuild from a whole date column
+    void build(const int32_t *days, size_t rows) {
+        clear();
+        sorted.reserve(rows);
+        bool inOrder = true;
+        for (size_t i = 0; i < rows; i++) {
+            if (i > 0 && days[i] < days[i - 1]) inOrder = false;
+            sorted.push_back(Entry{days[i], static_cast<uint32_t>(i)});
+        }
+        // Ledgers are usually written chronologically; skip the sort then
+        if (!inOrder) std::sort(sorted.begin(), sorted.end());
+    }
+
+    // Index one new row
+    void add(int32_t day, uint32_t row) {
+        Entry e{day, row};
+        if (sorted.empty() || !(e < sorted.back())) {
+            sorted.push_back(e);
+            return;
+        }
+        delta.insert(std::upper_bound(delta.begin(), delta.end(), e), e);
+        if (delta.size() > std::max(kMinDelta, sorted.size() / 16)) mergeDelta();
+    }
+
+    // Index rows first..last-1 in one step (bulk appends)
+    void addRange(const int32_t *days, size_t first, size_t last) {
+        if (first >= last) return;
+        std::vector<Entry> fresh;
+        fresh.reserve(last - first);
+        bool inOrder = sorted.empty() || !(Entry{days[first], static_cast<uint32_t>(first)} < sorted.back());
+        for (size_t i = first; i < last; i++) {
+            if (i > first && days[i] < days[i - 1]) inOrder = false;
+            fresh.push_back(Entry{days[i], static_cast<uint32_t>(i)});
+        }
+        if (!inOrder) std::sort(fresh.begin(), fresh.end());
+
+        // One merge into the main run, folding in any pending delta as well
+        size_t mid = sorted.size();
+        sorted.insert(sorted.end(), fresh.begin(), fresh.end());
+        if (!inOrder) std::inplace_merge(sorted.begin(), sorted.begin() + mid, sorted.end());
+        if (!delta.empty()) mergeDelta();
+    }
+
+    // Rows with from <= day <= to, in (day, row) order
+    std::vector<uint32_t> range(int32_t from, int32_t to) const {
+        std::vector<uint32_t> rows;
+        if (from > to) return rows;
+        Iter lo = lowerBound(sorted, from), hi = upperBound(sorted, to);
+        Iter dlo = lowerBound(delta, from), dhi = upperBound(delta, to);
+        rows.reserve((hi - lo) + (dhi - dlo));
+
+        // Two-way merge of the main run and the delta
+        while (lo != hi || dlo != dhi) {
+            if (dlo == dhi || (lo != hi && *lo < *dlo)) rows.push_back((lo++)->row);
+            else rows.push_back((dlo++)->row);
+        }
+        return rows;
+    }
+};
@@ -0,0 +1,148 @@
+// cpp/include/date_util.h
+#pragma once
+#include <cstdint>
+#include <climits>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// Dates are packed as days since 1970-01-01 so range checks are integer compares
+constexpr int32_t kNoDate = INT32_MIN; // missing or unrecognized date
+
+constexpr bool isLeapYear(int y) {
+    return (y % 4 == 0 && y % 100 != 0) || (y % 400 == 0);
+}
+
+// Month lengths for common and leap years, built at compile time
+struct CalendarTable {
+    int8_t monthDays[2][13] = {};    // [leap][month], month 1..12
+};
+
+constexpr CalendarTable makeCalendarTable() {
+    CalendarTable t;
+    constexpr int8_t common[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    for (int m = 1; m <= 12; m++) {
+        t.monthDays[0][m] = common[m - 1];
+        t.monthDays[1][m] = m == 2 ? 29 : common[m - 1];
+    }
+    return t;
+}
+
+inline constexpr CalendarTable kCalendar = makeCalendarTable();
+
+constexpr int daysInMonth(int y, int m) {
+    return kCalendar.monthDays[isLeapYear(y)][m];
+}
+
+// Civil date -> day number (Howard Hinnant's days_from_civil)
+constexpr int32_t daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Day number -> civil date
+constexpr void civilFromDays(int32_t z, int &y, int &m, int &d) {
+    z += 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const int doe = z - era * 146097;
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+// Parse YYYY-MM-DD into a day number, or kNoDate if it is not a real date.
+// No allocation and no locale; the eight digit checks fold into one test
+// and month lengths come from the compile-time table, so it also runs in
+// constant expressions.
+constexpr int32_t parseDate(std::string_view s) {
+    if (s.size() != 10 || s[4] != '-' || s[7] != '-') return kNoDate;
+    constexpr int pos[8] = {0, 1, 2, 3, 5, 6, 8, 9};
+    unsigned v[8] = {};
+    unsigned bad = 0;
+    for (int i = 0; i < 8; i++) {
+        v[i] = static_cast<unsigned>(static_cast<unsigned char>(s[pos[i]])) - '0';
+        bad |= v[i] > 9;
+    }
+    int y = static_cast<int>(v[0] * 1000 + v[1] * 100 + v[2] * 10 + v[3]);
+    int m = static_cast<int>(v[4] * 10 + v[5]);
+    int d = static_cast<int>(v[6] * 10 + v[7]);
+    if (bad || static_cast<unsigned>(m - 1) >= 12 ||
+        static_cast<unsigned>(d - 1) >= static_cast<unsigned>(daysInMonth(y, m)))
+        return kNoDate;
+    return daysFromCivil(y, m, d);
+}
+
+static_assert(parseDate("1970-01-01") == 0, "day numbers count from 1970-01-01");
+static_assert(parseDate("2024-02-29") == daysFromCivil(2024, 2, 29), "leap day");
+static_assert(parseDate("2023-02-29") == kNoDate && parseDate("2024-13-01") == kNoDate &&
+              parseDate("2024-1-015") == kNoDate, "rejected dates");
+
+// Today's day number in local time
+inline int32_t localToday() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    return daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+// Accepts real dates from 1900-01-01 up to today (and no later than
+// 2100-12-31). Today is read from the clock once, when the validator is
+// made: keep one per batch or import and each check is a parse plus two
+// integer compares.
+class DateValidator {
+private:
+    int32_t last;
+
+public:
+    static constexpr int32_t kFirstDay = daysFromCivil(1900, 1, 1);
+    static constexpr int32_t kLastDay = daysFromCivil(2100, 12, 31);
+
+    DateValidator() : DateValidator(localToday()) {}
+    explicit DateValidator(int32_t today) : last(today < kLastDay ? today : kLastDay) {}
+
+    int32_t lastDay() const { return last; }
+
+    // kNoDate is below kFirstDay, so unparsed dates fail too
+    bool accepts(int32_t day) const { return day >= kFirstDay && day <= last; }
+    bool accepts(std::string_view date) const { return accepts(parseDate(date)); }
+};
+
+// YYYY-MM-DD, a real date, between 1900 and 2100 and not in the future
+inline bool isValidDate(std::string_view date) {
+    return DateValidator().accepts(date);
+}
+
+// Write a day number as YYYY-MM-DD to out (nothing for kNoDate); returns the end
+inline char *formatDate(int32_t day, char *out) {
+    if (day == kNoDate) return out;
+    int y, m, d;
+    civilFromDays(day, y, m, d);
+    out[0] = char('0' + y / 1000 % 10);
+    out[1] = char('0' + y / 100 % 10);
+    out[2] = char('0' + y / 10 % 10);
+    out[3] = char('0' + y % 10);
+    out[4] = '-';
+    out[5] = char('0' + m / 10);
+    out[6] = char('0' + m % 10);
+    out[7] = '-';
+    out[8] = char('0' + d / 10);
+    out[9] = char('0' + d % 10);
+    return out + 10;
+}
+
+// Format a day number as YYYY-MM-DD (kNoDate formats as an empty string)
+inline std::string formatDate(int32_t day) {
+    char buf[10];
+    return std::string(buf, formatDate(day, buf));
+}
@@ -3,21 +3,42 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include "money.h"
 
 // Expense struct definition
 struct Expense {
     std::string id;          // unique identifier
     std::string date;        // format: YYYY-MM-DD
-    double amount;           // expense amount
+    Money amount;            // expense amount (exact cents)
     std::string category;    // e.g., Food, Travel, Rent
     std::string description; // short text
 
-    // Display function
+    // Display function (one row; use ExpenseWriter for listings)
     void display() const {
         std::cout << std::left << std::setw(8) << id 
                   << std::setw(12) << date 
-                  << std::setw(10) << std::fixed << std::setprecision(2) << "$" << amount
+                  << std::setw(10) << ("$" + amount.toString())
                   << std::setw(15) << category 
-                  << description << std::endl;
+                  << description << '\n';
+    }
+};
+
+// Per-category aggregate returned by summary queries
+struct CategoryTotal {
+    std::string category;
+    Money total;             // sum of amounts
+    size_t count = 0;        // number of expenses
+};
+
+// Amount statistics over a group of expenses
+struct CategoryStats {
+    std::string category;    // empty for an all-category aggregate
+    Money total;
+    size_t count = 0;
+    Money min;
+    Money max;
+
+    Money average() const {
+        return count ? Money::fromUnits(total.raw() / static_cast<int64_t>(count)) : Money();
     }
 };
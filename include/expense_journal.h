@@ -0,0 +1,261 @@
+// cpp/include/expense_journal.h
+#pragma once
+#include "expense_snapshot.h"
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+// Append-only journal that sits next to the base CSV file.
+//
+// Each record is one line: an operation tag followed by its payload, e.g.
+//   A,E1001,2024-01-15,25.50,Food,Lunch     add a row
+//   U,E1001,2024-01-15,27.00,Food,Lunch     replace the row with that id
+//   D,E1001                                 delete the row with that id
+// The first line is a header that stamps the base file the journal applies
+// to, the same way a snapshot stamps its CSV:
+//   #journal base=1234 mtime=1700000000123456789 [hash=9f3a...]
+// (size, nanosecond mtime, and a content hash when the mtime alone could
+// not tell a rewrite apart). Compaction rewrites the base file, so if we
+// crash after the base was replaced but before the journal was reset, or
+// the CSV is edited by hand, the stamp no longer matches: replay ignores
+// the journal, and the next append moves it aside (to <journal>.stale)
+// and starts a new one, so new records are never written under a header
+// that makes them unreadable.
+class ExpenseJournal {
+private:
+    std::string basePath;
+    std::string path;
+    std::FILE *out = nullptr;
+    size_t syncEvery = 1;     // fsync after this many appends (group commit)
+    size_t pending = 0;       // appends since last fsync
+    size_t records = 0;       // records currently in the journal
+
+    static long long fileSize(const std::string &p) {
+        struct stat st;
+        if (stat(p.c_str(), &st) != 0) return -1;
+        return static_cast<long long>(st.st_size);
+    }
+
+    static void fsyncFile(std::FILE *f) {
+        std::fflush(f);
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+    }
+
+    // Cut the file back to length bytes
+    static bool truncateFile(const std::string &p, long long length) {
+#ifdef _WIN32
+        int fd = _open(p.c_str(), _O_WRONLY | _O_BINARY);
+        if (fd < 0) return false;
+        bool ok = _chsize_s(fd, length) == 0;
+        _close(fd);
+        return ok;
+#else
+        return truncate(p.c_str(), static_cast<off_t>(length)) == 0;
+#endif
+    }
+
+    // Cut off a last record torn by a crash (one without its newline), so
+    // the next append starts on a fresh line instead of extending it
+    static void dropTornRecord(const std::string &p) {
+        long long size = fileSize(p);
+        if (size <= 0) return;
+        std::FILE *f = std::fopen(p.c_str(), "rb");
+        if (!f) return;
+        // Walk back from the end to the last newline
+        char block[4096];
+        long long end = size, keep = 0;
+        bool complete = false;
+        while (end > 0 && keep == 0) {
+            long long start = std::max(0LL, end - static_cast<long long>(sizeof(block)));
+            size_t n = static_cast<size_t>(end - start);
+            if (std::fseek(f, static_cast<long>(start), SEEK_SET) != 0 || std::fread(block, 1, n, f) != n) break;
+            if (end == size && block[n - 1] == '\n') {
+                complete = true;
+                break;
+            }
+            for (size_t i = n; i-- > 0;) {
+                if (block[i] == '\n') {
+                    keep = start + static_cast<long long>(i) + 1;
+                    break;
+                }
+            }
+            end = start;
+        }
+        std::fclose(f);
+        if (complete) return;
+        if (!truncateFile(p, keep)) {
+            std::cerr << "Warning: could not drop torn record from journal " << p << "\n";
+        }
+    }
+
+    // Header line stamping the base file as it is now (a missing base counts
+    // as size 0); written at time created, the journal file's own mtime
+    std::string header(int64_t created) const {
+        int64_t size, mtime;
+        ExpenseSnapshot::fileStamp(basePath, size, mtime);
+        std::string h = "#journal base=" + std::to_string(size < 0 ? 0 : size) +
+                        " mtime=" + std::to_string(size < 0 ? 0 : mtime);
+        if (size > 0 && ExpenseSnapshot::sameTick(mtime, created)) {
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx",
+                          static_cast<unsigned long long>(ExpenseSnapshot::fileHash(basePath)));
+            h += " hash=";
+            h += hex;
+        }
+        return h;
+    }
+
+    // Value of key=... in a header line ("" if absent)
+    static std::string headerField(const std::string &line, const char *key) {
+        std::string tag = std::string(" ") + key + "=";
+        size_t p = line.find(tag);
+        if (p == std::string::npos) return std::string();
+        p += tag.size();
+        return line.substr(p, line.find(' ', p) - p);
+    }
+
+    // True if a header line still describes the base file
+    bool matchesBase(const std::string &line) const {
+        if (line.compare(0, 9, "#journal ") != 0) return false;
+        int64_t size, mtime;
+        ExpenseSnapshot::fileStamp(basePath, size, mtime);
+        if (size < 0) size = mtime = 0;
+        if (headerField(line, "base") != std::to_string(size)) return false;
+        std::string stamped = headerField(line, "mtime");
+        if (stamped.empty()) return true;   // written before mtimes were stamped
+        if (stamped != std::to_string(mtime)) return false;
+        std::string hash = headerField(line, "hash");
+        return hash.empty() ||
+               std::strtoull(hash.c_str(), nullptr, 16) == ExpenseSnapshot::fileHash(basePath);
+    }
+
+    // Move a journal that no longer matches its base file out of the way
+    void quarantine() {
+        std::string target = path + ".stale";
+        for (int n = 1; fileSize(target) >= 0; n++) target = path + ".stale." + std::to_string(n);
+        if (std::rename(path.c_str(), target.c_str()) != 0) {
+            std::cerr << "Error: could not move stale journal " << path << " aside\n";
+            return;
+        }
+        std::cerr << "Warning: journal " << path << " does not match base file; moved it to "
+                  << target << " and started a new journal.\n";
+    }
+
+    // First line of the journal file ("" if it has none)
+    std::string firstLine() const {
+        std::ifstream in(path, std::ios::binary);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+public:
+    explicit ExpenseJournal(const std::string &base)
+        : basePath(base), path(base + ".journal") {}
+
+    ~ExpenseJournal() { close(); }
+
+    ExpenseJournal(const ExpenseJournal &) = delete;
+    ExpenseJournal &operator=(const ExpenseJournal &) = delete;
+
+    const std::string &getPath() const { return path; }
+
+    // File whose size stamps the journal (defaults to the CSV it sits next to)
+    void setBasePath(const std::string &base) { basePath = base; }
+    size_t recordCount() const { return records; }
+    bool exists() const { return fileSize(path) >= 0; }
+
+    // Number of appends grouped into one fsync (1 = sync every record)
+    void setSyncInterval(size_t n) { syncEvery = n == 0 ? 1 : n; }
+
+    // Replay complete records if the journal matches the base file.
+    // Returns the number of records handed to apply().
+    size_t replay(const std::function<void(char op, const std::string &row)> &apply) {
+        records = 0;
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return 0;
+
+        std::string line;
+        if (!std::getline(in, line)) return 0;
+        if (!matchesBase(line)) {
+            std::cerr << "Warning: journal " << path
+                      << " does not match base file, ignoring it.\n";
+            return 0;
+        }
+
+        while (std::getline(in, line)) {
+            // A record without a trailing newline was torn by a crash
+            if (in.eof()) break;
+            if (line.size() < 2 || line[1] != ',') continue;
+            apply(line[0], line.substr(2));
+            records++;
+        }
+        return records;
+    }
+
+    // Append one record; fsync once every syncEvery appends unless the
+    // caller batches records and calls sync() itself
+    bool append(char op, const std::string &row, bool deferSync = false) {
+        if (!out) {
+            if (fileSize(path) > 0 && !matchesBase(firstLine())) quarantine();
+            dropTornRecord(path);
+            bool fresh = fileSize(path) <= 0;
+            out = std::fopen(path.c_str(), "ab");
+            if (!out) {
+                std::cerr << "Error: Could not open journal " << path << std::endl;
+                return false;
+            }
+            if (fresh) {
+                int64_t size, created;
+                ExpenseSnapshot::fileStamp(path, size, created);
+                std::string h = header(created) + "\n";
+                std::fwrite(h.data(), 1, h.size(), out);
+            }
+        }
+        std::string line;
+        line.reserve(row.size() + 3);
+        line += op;
+        line += ',';
+        line += row;
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), out);
+        records++;
+        if (++pending >= syncEvery && !deferSync) sync();
+        return true;
+    }
+
+    // Force buffered records to disk
+    void sync() {
+        if (out && pending > 0) fsyncFile(out);
+        pending = 0;
+    }
+
+    void close() {
+        if (!out) return;
+        sync();
+        std::fclose(out);
+        out = nullptr;
+    }
+
+    // Drop all records after the base file was rewritten
+    void reset() {
+        close();
+        std::remove(path.c_str());
+        records = 0;
+    }
+};
@@ -0,0 +1,345 @@
+// cpp/include/expense_query.h
+#pragma once
+#include "expense_table.h"
+#include "date_index.h"
+#include "text_index.h"
+#include "date_util.h"
+#include "aggregate_kernels.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of one row of an ExpenseTable. Valid until the table is
+// cleared or destroyed; call materialize() to keep a copy.
+class ExpenseView {
+private:
+    const ExpenseTable *table;
+    size_t i;
+
+public:
+    ExpenseView(const ExpenseTable &t, size_t row) : table(&t), i(row) {}
+
+    size_t row() const { return i; }
+    std::string_view id() const { return table->id(i); }
+    int32_t day() const { return table->day(i); }
+    std::string date() const {
+        char buf[10];
+        return std::string(table->dateText(i, buf));
+    }
+    Money amount() const { return table->amount(i); }
+    const std::string &category() const { return table->categoryName(table->categoryCode(i)); }
+    std::string_view description() const { return table->description(i); }
+    Expense materialize() const { return table->materialize(i); }
+};
+
+// Matching rows of a query, iterated as ExpenseView
+class QueryResult {
+private:
+    const ExpenseTable *table;
+    std::vector<uint32_t> rowList;
+
+public:
+    class Iterator {
+    private:
+        const ExpenseTable *table;
+        const uint32_t *pos;
+
+    public:
+        Iterator(const ExpenseTable *t, const uint32_t *p) : table(t), pos(p) {}
+        ExpenseView operator*() const { return ExpenseView(*table, *pos); }
+        Iterator &operator++() { ++pos; return *this; }
+        bool operator!=(const Iterator &o) const { return pos != o.pos; }
+        bool operator==(const Iterator &o) const { return pos == o.pos; }
+    };
+
+    QueryResult(const ExpenseTable &t, std::vector<uint32_t> &&rows)
+        : table(&t), rowList(std::move(rows)) {}
+
+    size_t size() const { return rowList.size(); }
+    bool empty() const { return rowList.empty(); }
+    ExpenseView operator[](size_t k) const { return ExpenseView(*table, rowList[k]); }
+    const std::vector<uint32_t> &rows() const { return rowList; }
+    Iterator begin() const { return Iterator(table, rowList.data()); }
+    Iterator end() const { return Iterator(table, rowList.data() + rowList.size()); }
+
+    std::vector<Expense> materialize() const {
+        std::vector<Expense> result;
+        result.reserve(rowList.size());
+        for (uint32_t i : rowList) result.push_back(table->materialize(i));
+        return result;
+    }
+};
+
+// Public stats for one category from kernel accumulators
+inline CategoryStats toCategoryStats(const std::string &category, const KernelStats &k) {
+    CategoryStats s;
+    s.category = category;
+    s.total = Money::fromUnits(k.sum);
+    s.count = k.count;
+    if (k.count > 0) {
+        s.min = Money::fromUnits(k.min);
+        s.max = Money::fromUnits(k.max);
+    }
+    return s;
+}
+
+// Declarative filter over an ExpenseTable. Every predicate is optional and
+// they are all evaluated in a single pass:
+//
+//   ExpenseQuery().between("2025-01-01", "2025-03-31")
+//                 .inCategory("Food").inCategory("Rent")
+//                 .amountAtLeast(Money(10)).contains("lunch")
+//                 .sortBy(ExpenseQuery::SortKey::Amount, true).limit(20)
+//
+// Word searches (search("uber taxi*")) are answered from the text index
+// when one is given, and a date range from the date index, so only
+// candidate rows are visited; the remaining predicates run on the columns
+// (category codes, integer cents) before any text is touched.
+class ExpenseQuery {
+public:
+    enum class SortKey { None, Date, Amount, Category, Id };
+
+    int32_t from = INT32_MIN;           // day range (inclusive)
+    int32_t to = INT32_MAX;
+    bool invalid = false;               // a bound could not be parsed: nothing matches
+    std::vector<std::string> categories; // any of these; empty = all
+    bool hasMin = false, hasMax = false;
+    Money minAmount, maxAmount;         // amount range (inclusive)
+    std::string text;                   // case-insensitive description substring
+    std::vector<TextTerm> terms;        // description words; all must match unless anyTerm
+    bool anyTerm = false;
+    SortKey sortKey = SortKey::None;    // None keeps file order
+    bool descending = false;
+    size_t skip = 0;
+    size_t count = SIZE_MAX;
+
+    // Date bounds as YYYY-MM-DD; an empty string leaves that side open
+    ExpenseQuery &between(const std::string &start, const std::string &end) {
+        if (!start.empty()) setBound(start, from);
+        if (!end.empty()) setBound(end, to);
+        return *this;
+    }
+
+    ExpenseQuery &betweenDays(int32_t first, int32_t last) {
+        from = first;
+        to = last;
+        return *this;
+    }
+
+    ExpenseQuery &inCategory(const std::string &category) {
+        categories.push_back(category);
+        return *this;
+    }
+
+    ExpenseQuery &amountAtLeast(Money amount) {
+        hasMin = true;
+        minAmount = amount;
+        return *this;
+    }
+
+    ExpenseQuery &amountAtMost(Money amount) {
+        hasMax = true;
+        maxAmount = amount;
+        return *this;
+    }
+
+    ExpenseQuery &contains(const std::string &needle) {
+        text = needle;
+        return *this;
+    }
+
+    // Whole words of the description, e.g. "uber airport" or "taxi*" for a
+    // prefix; all of them must appear, or any one of them with any = true
+    ExpenseQuery &search(const std::string &words, bool any = false) {
+        terms = parseTextTerms(words);
+        anyTerm = any;
+        return *this;
+    }
+
+    ExpenseQuery &sortBy(SortKey key, bool desc = false) {
+        sortKey = key;
+        descending = desc;
+        return *this;
+    }
+
+    ExpenseQuery &offset(size_t n) {
+        skip = n;
+        return *this;
+    }
+
+    ExpenseQuery &limit(size_t n) {
+        count = n;
+        return *this;
+    }
+
+    // Rows up to the end of the page (offset + limit, SIZE_MAX if unbounded
+    // or if the sum would overflow)
+    size_t pageEnd() const { return count > SIZE_MAX - skip ? SIZE_MAX : skip + count; }
+
+    bool hasDateRange() const { return from != INT32_MIN || to != INT32_MAX; }
+
+    // Matching rows of table, sorted and paged. index and words (both
+    // optional) must cover every row of table.
+    std::vector<uint32_t> select(const ExpenseTable &table, const DateIndex *index = nullptr,
+                                 const TextIndex *words = nullptr) const {
+        std::vector<uint32_t> rows;
+        std::vector<char> wanted;
+        if (!prepare(table, wanted)) return rows;
+
+        // Without sorting, file order lets the scan stop once the page is full
+        size_t stopAt = SIZE_MAX;
+        if (sortKey == SortKey::None) stopAt = pageEnd();
+
+        if (!terms.empty() && words) {
+            // Rows holding the words, already in file order
+            for (uint32_t i : words->lookup(terms, anyTerm)) {
+                if (rows.size() >= stopAt) break;
+                if (matchDate(table.day(i)) && matchColumns(table, i, wanted)) rows.push_back(i);
+            }
+        } else if (hasDateRange() && index) {
+            std::vector<uint32_t> hits = index->range(std::max(from, kNoDate + 1), to);
+            std::sort(hits.begin(), hits.end());
+            for (uint32_t i : hits) {
+                if (rows.size() >= stopAt) break;
+                if (matchColumns(table, i, wanted) && matchTerms(table, i)) rows.push_back(i);
+            }
+        } else {
+            for (size_t i = 0; i < table.size() && rows.size() < stopAt; i++) {
+                if (matchDate(table.day(i)) && matchColumns(table, i, wanted) && matchTerms(table, i))
+                    rows.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        sortRows(table, rows);
+        page(rows);
+        return rows;
+    }
+
+    // Per-category stats over every matching row (index = category code);
+    // sorting and paging do not apply
+    std::vector<KernelStats> aggregate(const ExpenseTable &table, const DateIndex *index = nullptr,
+                                       const TextIndex *words = nullptr) const {
+        std::vector<char> wanted;
+        if (!prepare(table, wanted)) return std::vector<KernelStats>(table.categoryCount());
+
+        // Date-only queries go straight to the vectorized kernel, which
+        // cannot see tombstones
+        if (wanted.empty() && !hasMin && !hasMax && text.empty() && terms.empty() &&
+            table.deadCount() == 0) {
+            // Any bound excludes undated rows, which are stored as INT32_MIN
+            int32_t lo = hasDateRange() ? std::max(from, kNoDate + 1) : from;
+            return aggregateByCategory(table.dayData(), table.categoryData(), table.amountData(),
+                                       table.size(), table.categoryCount(), lo, to);
+        }
+
+        ExpenseQuery all = *this;
+        all.sortKey = SortKey::None;
+        all.skip = 0;
+        all.count = SIZE_MAX;
+        std::vector<KernelStats> stats(table.categoryCount());
+        for (uint32_t i : all.select(table, index, words))
+            stats[table.categoryCode(i)].add(table.amountData()[i]);
+        return stats;
+    }
+
+private:
+    void setBound(const std::string &date, int32_t &bound) {
+        bound = parseDate(date);
+        if (bound == kNoDate) invalid = true;
+    }
+
+    // Resolve category names to a code mask; false if nothing can match
+    bool prepare(const ExpenseTable &table, std::vector<char> &wanted) const {
+        if (invalid || from > to) return false;
+        if (hasMin && hasMax && minAmount > maxAmount) return false;
+        if (categories.empty()) return true;
+        wanted.assign(table.categoryCount(), 0);
+        bool any = false;
+        for (const std::string &name : categories) {
+            uint32_t code = table.categoryDictionary().find(name);
+            if (code == CategoryDictionary::kNotFound) continue;
+            wanted[code] = 1;
+            any = true;
+        }
+        return any;
+    }
+
+    bool matchDate(int32_t day) const {
+        if (!hasDateRange()) return true;
+        return day != kNoDate && day >= from && day <= to;
+    }
+
+    bool matchColumns(const ExpenseTable &table, size_t i, const std::vector<char> &wanted) const {
+        if (!table.isLive(i)) return false;
+        if (!wanted.empty() && !wanted[table.categoryCode(i)]) return false;
+        int64_t cents = table.amountData()[i];
+        if (hasMin && cents < minAmount.raw()) return false;
+        if (hasMax && cents > maxAmount.raw()) return false;
+        return text.empty() || containsIgnoreCase(table.description(i), text);
+    }
+
+    // Word search for rows the text index did not already select
+    bool matchTerms(const ExpenseTable &table, size_t i) const {
+        return terms.empty() || TextIndex::matches(table.description(i), terms, anyTerm);
+    }
+
+    static char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static bool containsIgnoreCase(std::string_view hay, std::string_view needle) {
+        if (needle.size() > hay.size()) return false;
+        for (size_t i = 0; i + needle.size() <= hay.size(); i++) {
+            size_t k = 0;
+            while (k < needle.size() && lower(hay[i + k]) == lower(needle[k])) k++;
+            if (k == needle.size()) return true;
+        }
+        return false;
+    }
+
+    void sortRows(const ExpenseTable &table, std::vector<uint32_t> &rows) const {
+        if (sortKey == SortKey::None) return;
+        // Order by key, ties in file order; only the requested page is fully sorted
+        auto less = [&](uint32_t a, uint32_t b) {
+            int c = compare(table, a, b);
+            if (descending) c = -c;
+            return c != 0 ? c < 0 : a < b;
+        };
+        size_t need = pageEnd();
+        if (need < rows.size()) {
+            std::partial_sort(rows.begin(), rows.begin() + need, rows.end(), less);
+            rows.resize(need);
+        } else {
+            std::sort(rows.begin(), rows.end(), less);
+        }
+    }
+
+    int compare(const ExpenseTable &table, uint32_t a, uint32_t b) const {
+        switch (sortKey) {
+        case SortKey::Date:
+            return table.day(a) < table.day(b) ? -1 : table.day(a) > table.day(b);
+        case SortKey::Amount: {
+            int64_t x = table.amountData()[a], y = table.amountData()[b];
+            return x < y ? -1 : x > y;
+        }
+        case SortKey::Category:
+            return table.categoryName(table.categoryCode(a))
+                .compare(table.categoryName(table.categoryCode(b)));
+        case SortKey::Id:
+            return table.id(a).compare(table.id(b));
+        default:
+            return 0;
+        }
+    }
+
+    void page(std::vector<uint32_t> &rows) const {
+        if (skip >= rows.size()) {
+            rows.clear();
+            return;
+        }
+        rows.erase(rows.begin(), rows.begin() + skip);
+        if (rows.size() > count) rows.resize(count);
+    }
+};
@@ -0,0 +1,257 @@
+// cpp/include/expense_snapshot.h
+#pragma once
+#include "expense_table.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+// Versioned binary image of an ExpenseTable.
+//
+// Layout (native little-endian, every section 8-byte aligned):
+//   Header
+//   int32  days[rows]
+//   int64  amounts[rows]
+//   uint32 categories[rows]
+//   uint64 textStart[rows + 1]
+//   uint32 idLength[rows]
+//   char   text[textBytes]
+//   { uint32 length; char name[length]; } x categoryCount
+//   { uint32 row; uint32 length; char text[length]; } x rawDateCount
+//
+// Loading maps the file and copies each column with one bulk copy, so
+// startup is bounded by memory bandwidth instead of CSV parsing. The
+// header stamps the size, nanosecond mtime and content hash of the CSV
+// file the snapshot was taken from; a snapshot whose CSV has changed or
+// disappeared since is treated as stale. The hash is only checked when the
+// CSV's mtime is within one timestamp tick of the snapshot's own, where a
+// rewrite could have kept the same size and mtime; on filesystems with
+// sub-second timestamps that window is a few milliseconds, so a large CSV
+// is practically never hashed on load.
+class ExpenseSnapshot {
+public:
+    static constexpr char kMagic[8] = {'E', 'X', 'P', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr uint32_t kVersion = 3;
+    static constexpr int64_t kCoarseTick = 2000000000; // mtime granularity of FAT
+    static constexpr int64_t kFineTick = 20000000;     // of a kernel clock tick (HZ >= 100)
+    static constexpr uint32_t kByteOrder = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t rows;
+        uint64_t textBytes;
+        uint64_t categoryCount;
+        uint64_t rawDateCount;  // rows keeping the text of a date that did not parse
+        int64_t sourceSize;    // CSV size when written, -1 if there was none
+        int64_t sourceMtime;   // CSV mtime when written, in nanoseconds
+        uint64_t sourceHash;   // checksum of the CSV contents
+        uint64_t checksum;     // over everything after the header
+    };
+
+    // Stamp (size, mtime in nanoseconds) of a file; size is -1 if it does not exist
+    static void fileStamp(const std::string &path, int64_t &size, int64_t &mtime) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            size = -1;
+            mtime = 0;
+            return;
+        }
+        size = static_cast<int64_t>(st.st_size);
+#if defined(__APPLE__)
+        mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+        mtime = static_cast<int64_t>(st.st_mtime) * 1000000000;
+#else
+        mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    }
+
+    // True if a file stamped with mtime could have been rewritten, keeping
+    // its mtime, up to a moment whose (filesystem) time is later
+    static bool sameTick(int64_t mtime, int64_t later) {
+        int64_t tick = (mtime % 1000000000 != 0 || later % 1000000000 != 0) ? kFineTick : kCoarseTick;
+        return later - mtime < tick;
+    }
+
+    // Checksum of a file's contents (0 if it is missing or empty)
+    static uint64_t fileHash(const std::string &path) {
+        MappedFile file(path);
+        if (!file.isOpen() || file.size() == 0) return 0;
+        return checksum(file.data(), file.size());
+    }
+
+    // 64-bit hash that consumes 8 bytes per step
+    static uint64_t checksum(const char *data, size_t len, uint64_t h = 0x9E3779B97F4A7C15ull) {
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, data + i, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; i < len; i++) {
+            h = (h ^ static_cast<unsigned char>(data[i])) * 0xC4CEB9FE1A85EC53ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    // Write the table to path (via a temp file), stamped with sourcePath's
+    // size, mtime and hash
+    static bool write(const ExpenseTable &table, const std::string &path,
+                      const std::string &sourcePath) {
+        std::string body;
+        size_t rows = table.size();
+        appendColumn(body, table.days.data(), rows);
+        appendColumn(body, table.amounts.data(), rows);
+        appendColumn(body, table.categories.data(), rows);
+        // Row text is stored packed, addressed by cumulative offsets
+        std::vector<uint64_t> textStart(rows + 1, 0);
+        for (size_t i = 0; i < rows; i++) textStart[i + 1] = textStart[i] + table.textLength[i];
+        appendColumn(body, textStart.data(), rows + 1);
+        appendColumn(body, table.idLength.data(), rows);
+        body.reserve(body.size() + textStart[rows] + 8);
+        for (size_t i = 0; i < rows; i++) body.append(table.textPtr[i], table.textLength[i]);
+        pad(body);
+        for (size_t c = 0; c < table.dictionary.size(); c++) {
+            const std::string &name = table.dictionary.name(static_cast<uint32_t>(c));
+            uint32_t len = static_cast<uint32_t>(name.size());
+            body.append(reinterpret_cast<const char *>(&len), sizeof(len));
+            body.append(name);
+        }
+        for (const auto &r : table.rawDates) {
+            uint32_t fields[2] = {r.first, static_cast<uint32_t>(r.second.size())};
+            body.append(reinterpret_cast<const char *>(fields), sizeof(fields));
+            body.append(r.second);
+        }
+
+        Header h;
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.byteOrder = kByteOrder;
+        h.rows = rows;
+        h.textBytes = table.arena.size();
+        h.categoryCount = table.dictionary.size();
+        h.rawDateCount = table.rawDates.size();
+        fileStamp(sourcePath, h.sourceSize, h.sourceMtime);
+        h.sourceHash = h.sourceSize > 0 ? fileHash(sourcePath) : 0;
+        h.checksum = checksum(body.data(), body.size());
+
+        std::string tmpPath = path + ".tmp";
+        std::FILE *out = std::fopen(tmpPath.c_str(), "wb");
+        if (!out) {
+            std::cerr << "Error: Could not write snapshot " << path << std::endl;
+            return false;
+        }
+        bool ok = std::fwrite(&h, sizeof(h), 1, out) == 1 &&
+                  std::fwrite(body.data(), 1, body.size(), out) == body.size();
+        ok = std::fclose(out) == 0 && ok;
+#ifdef _WIN32
+        if (ok) std::remove(path.c_str()); // rename() does not replace files on Windows
+#endif
+        if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            std::cerr << "Error: Could not write snapshot " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Load a snapshot into table. Fails (leaving table empty) if the file is
+    // missing, corrupt, from another version, or stale against sourcePath.
+    static bool read(ExpenseTable &table, const std::string &path,
+                     const std::string &sourcePath) {
+        table.clear();
+        MappedFile file(path);
+        if (!file.isOpen() || file.size() < sizeof(Header)) return false;
+
+        Header h;
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+            h.version != kVersion || h.byteOrder != kByteOrder) return false;
+
+        // A missing source is only current if there was none when written
+        int64_t size, mtime, snapSize, snapMtime;
+        fileStamp(sourcePath, size, mtime);
+        if (size != h.sourceSize || (size >= 0 && mtime != h.sourceMtime)) return false;
+        fileStamp(path, snapSize, snapMtime);
+        if (size > 0 && sameTick(mtime, snapMtime) && fileHash(sourcePath) != h.sourceHash) return false;
+
+        const char *body = file.data() + sizeof(Header);
+        size_t bodySize = file.size() - sizeof(Header);
+        if (checksum(body, bodySize) != h.checksum) {
+            std::cerr << "Warning: snapshot " << path << " is corrupt, ignoring it.\n";
+            return false;
+        }
+
+        size_t rows = static_cast<size_t>(h.rows);
+        size_t pos = 0;
+        std::vector<uint64_t> textStart;
+        bool ok = readColumn(body, bodySize, pos, table.days, rows) &&
+                  readColumn(body, bodySize, pos, table.amounts, rows) &&
+                  readColumn(body, bodySize, pos, table.categories, rows) &&
+                  readColumn(body, bodySize, pos, textStart, rows + 1) &&
+                  readColumn(body, bodySize, pos, table.idLength, rows);
+        if (ok && pos + h.textBytes <= bodySize && textStart[rows] == h.textBytes) {
+            // All text lands in one arena block; rows point into it
+            size_t bytes = static_cast<size_t>(h.textBytes);
+            char *text = table.arena.allocate(bytes);
+            if (bytes) std::memcpy(text, body + pos, bytes);
+            pos = aligned(pos + bytes);
+            table.textPtr.resize(rows);
+            table.textLength.resize(rows);
+            for (size_t i = 0; i < rows && ok; i++) {
+                ok = textStart[i] <= textStart[i + 1] && table.idLength[i] <= textStart[i + 1] - textStart[i];
+                table.textPtr[i] = text + textStart[i];
+                table.textLength[i] = static_cast<uint32_t>(textStart[i + 1] - textStart[i]);
+            }
+        } else {
+            ok = false;
+        }
+        for (uint64_t c = 0; ok && c < h.categoryCount; c++) {
+            uint32_t len;
+            if (pos + sizeof(len) > bodySize) { ok = false; break; }
+            std::memcpy(&len, body + pos, sizeof(len));
+            pos += sizeof(len);
+            if (pos + len > bodySize) { ok = false; break; }
+            table.dictionary.intern(std::string_view(body + pos, len));
+            pos += len;
+        }
+        for (uint64_t r = 0; ok && r < h.rawDateCount; r++) {
+            uint32_t fields[2];
+            if (pos + sizeof(fields) > bodySize) { ok = false; break; }
+            std::memcpy(fields, body + pos, sizeof(fields));
+            pos += sizeof(fields);
+            if (pos + fields[1] > bodySize || fields[0] >= rows) { ok = false; break; }
+            table.rawDates.emplace_back(fields[0], std::string(body + pos, fields[1]));
+            pos += fields[1];
+        }
+        table.badDates = table.rawDates.size();
+        if (!ok) table.clear();
+        return ok;
+    }
+
+private:
+    static size_t aligned(size_t n) { return (n + 7) & ~size_t(7); }
+
+    static void pad(std::string &body) { body.resize(aligned(body.size()), '\0'); }
+
+    template <typename T>
+    static void appendColumn(std::string &body, const T *data, size_t count) {
+        body.append(reinterpret_cast<const char *>(data), count * sizeof(T));
+        pad(body);
+    }
+
+    template <typename T>
+    static bool readColumn(const char *body, size_t bodySize, size_t &pos,
+                           std::vector<T> &column, size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (pos + bytes > bodySize) return false;
+        column.resize(count);
+        if (bytes) std::memcpy(column.data(), body + pos, bytes);
+        pos = aligned(pos + bytes);
+        return true;
+    }
+};
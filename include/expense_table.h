@@ -0,0 +1,290 @@
+// cpp/include/expense_table.h
+#pragma once
+#include "expense.h"
+#include "csv_scanner.h"
+#include "date_util.h"
+#include "category_dictionary.h"
+#include "string_arena.h"
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Column-oriented (structure-of-arrays) storage for expenses.
+//
+// Scans only touch the columns they need: dates are packed day numbers,
+// amounts sit in one contiguous array, categories are small dictionary
+// codes, and ids/descriptions live in a StringArena that the table owns.
+// Views returned by id() and description() stay valid until clear(). An
+// Expense is only materialized when a row has to be displayed or handed out.
+//
+// Rows are never removed in place: kill() marks a row dead (a tombstone) and
+// scans skip it, so row numbers and views stay stable until removeDead()
+// rewrites the table without the dead rows.
+//
+// A date that does not parse is stored as kNoDate, and its original text
+// is kept aside (like tombstones, only for the rows that have one) so the
+// row is written back exactly as it was read.
+class ExpenseTable {
+private:
+    std::vector<int32_t> days;          // packed date per row
+    std::vector<int64_t> amounts;       // amount per row, in cents
+    std::vector<uint32_t> categories;   // dictionary code per row
+    std::vector<const char *> textPtr;  // row text (id followed by description) in the arena
+    std::vector<uint32_t> textLength;   // bytes of row text
+    std::vector<uint32_t> idLength;     // id is the first idLength[i] bytes of the row text
+    StringArena arena;                  // owns all row text of this generation
+
+    CategoryDictionary dictionary;      // category code -> name
+    size_t badDates = 0;                // rows whose date text could not be parsed
+    std::vector<uint8_t> deadRows;      // 1 = tombstoned; only as long as the last dead row
+    size_t dead = 0;
+    std::vector<std::pair<uint32_t, std::string>> rawDates; // (row, date text) of unparsed dates, by row
+
+    friend class ExpenseSnapshot;       // bulk column (de)serialization
+    friend class ColumnarSegment;       // compressed column encoding
+
+public:
+    ExpenseTable() = default;
+    ExpenseTable(ExpenseTable &&) = default;
+    ExpenseTable &operator=(ExpenseTable &&) = default;
+
+    // Copies get their own arena
+    ExpenseTable(const ExpenseTable &other) {
+        *this = other;
+    }
+
+    ExpenseTable &operator=(const ExpenseTable &other) {
+        if (this == &other) return *this;
+        clear();
+        appendTable(other); // interns other's categories in code order: codes match
+        return *this;
+    }
+
+    size_t size() const { return days.size(); }
+    bool empty() const { return days.empty(); }
+
+    void clear() {
+        days.clear();
+        amounts.clear();
+        categories.clear();
+        textPtr.clear();
+        textLength.clear();
+        idLength.clear();
+        arena.clear();
+        dictionary.clear();
+        badDates = 0;
+        deadRows.clear();
+        dead = 0;
+        rawDates.clear();
+    }
+
+    void reserve(size_t rows, size_t textBytes = 0) {
+        days.reserve(rows);
+        amounts.reserve(rows);
+        categories.reserve(rows);
+        textPtr.reserve(rows);
+        textLength.reserve(rows);
+        idLength.reserve(rows);
+        if (textBytes > arena.size()) arena.reserve(textBytes - arena.size());
+    }
+
+    // Append one row from already-split fields
+    void append(std::string_view id, int32_t day, Money amount,
+                std::string_view category, std::string_view description) {
+        days.push_back(day);
+        amounts.push_back(amount.raw());
+        categories.push_back(dictionary.intern(category));
+        textPtr.push_back(arena.store(id, description));
+        textLength.push_back(static_cast<uint32_t>(id.size() + description.size()));
+        idLength.push_back(static_cast<uint32_t>(id.size()));
+    }
+
+    void append(const Expense &e) {
+        int32_t day = parseDate(e.date);
+        append(e.id, day, e.amount, e.category, e.description);
+        if (day == kNoDate) keepRawDate(e.date);
+    }
+
+    // Append a CSV row straight from the scanner's views
+    void append(const CsvRow &row) {
+        int32_t day = parseDate(row.date);
+        append(row.id, day, parseCsvAmount(row.amount), row.category, row.description);
+        if (day == kNoDate) keepRawDate(row.date);
+    }
+
+    // Copy all rows of another table to the end of this one
+    void appendTable(const ExpenseTable &other) {
+        appendRange(other, 0, other.size());
+        badDates += other.badDates;
+    }
+
+    // Move all rows of another table to the end of this one; its text is
+    // taken over without copying
+    void appendTable(ExpenseTable &&other) {
+        std::vector<uint32_t> remap = remapFrom(other);
+        reserve(size() + other.size());
+        days.insert(days.end(), other.days.begin(), other.days.end());
+        amounts.insert(amounts.end(), other.amounts.begin(), other.amounts.end());
+        for (uint32_t c : other.categories) categories.push_back(remap[c]);
+        textPtr.insert(textPtr.end(), other.textPtr.begin(), other.textPtr.end());
+        textLength.insert(textLength.end(), other.textLength.begin(), other.textLength.end());
+        idLength.insert(idLength.end(), other.idLength.begin(), other.idLength.end());
+        arena.adopt(std::move(other.arena));
+        badDates += other.badDates;
+        copyDead(other, 0, other.size(), size() - other.size());
+        copyRawDates(other, 0, other.size(), size() - other.size());
+        other.clear();
+    }
+
+    // Copy rows [first, last) of another table to the end of this one
+    void appendRange(const ExpenseTable &other, size_t first, size_t last) {
+        std::vector<uint32_t> remap = remapFrom(other);
+        size_t bytes = 0;
+        for (size_t i = first; i < last; i++) bytes += other.textLength[i];
+        reserve(size() + (last - first), arena.size() + bytes);
+        days.insert(days.end(), other.days.begin() + first, other.days.begin() + last);
+        amounts.insert(amounts.end(), other.amounts.begin() + first, other.amounts.begin() + last);
+        for (size_t i = first; i < last; i++) {
+            categories.push_back(remap[other.categories[i]]);
+            textPtr.push_back(arena.store(std::string_view(other.textPtr[i], other.textLength[i])));
+        }
+        textLength.insert(textLength.end(), other.textLength.begin() + first, other.textLength.begin() + last);
+        idLength.insert(idLength.end(), other.idLength.begin() + first, other.idLength.begin() + last);
+        copyDead(other, first, last, size() - (last - first));
+        copyRawDates(other, first, last, size() - (last - first));
+    }
+
+    // Copy row i of another table (its category resolved by name)
+    void appendRow(const ExpenseTable &other, size_t i) {
+        append(other.id(i), other.days[i], other.amount(i),
+               other.categoryName(other.categories[i]), other.description(i));
+        if (other.days[i] == kNoDate) keepRawDate(other.rawDate(i));
+    }
+
+    // Tombstone row i; it stays in place but scans no longer see it
+    void kill(size_t i) {
+        if (deadRows.size() <= i) deadRows.resize(i + 1, 0);
+        if (deadRows[i]) return;
+        deadRows[i] = 1;
+        dead++;
+    }
+
+    bool isLive(size_t i) const { return i >= deadRows.size() || !deadRows[i]; }
+    size_t deadCount() const { return dead; }
+    size_t liveCount() const { return size() - dead; }
+
+    // Rewrite the table without its dead rows (row numbers and views change)
+    void removeDead() {
+        if (dead == 0) return;
+        ExpenseTable live;
+        live.reserve(liveCount(), arena.size());
+        size_t i = 0;
+        while (i < size()) {
+            // Copy each run of live rows in one step
+            size_t first = i;
+            while (i < size() && isLive(i)) i++;
+            if (i > first) live.appendRange(*this, first, i);
+            while (i < size() && !isLive(i)) i++;
+        }
+        live.badDates = badDates;
+        *this = std::move(live);
+    }
+
+    // Column accessors
+    int32_t day(size_t i) const { return days[i]; }
+    Money amount(size_t i) const { return Money::fromUnits(amounts[i]); }
+    uint32_t categoryCode(size_t i) const { return categories[i]; }
+    const std::string &categoryName(uint32_t code) const { return dictionary.name(code); }
+    size_t categoryCount() const { return dictionary.size(); }
+    const CategoryDictionary &categoryDictionary() const { return dictionary; }
+    size_t badDateCount() const { return badDates; }
+    size_t textBytes() const { return arena.size(); }
+    const StringArena &textArena() const { return arena; }
+
+    std::string_view id(size_t i) const {
+        return std::string_view(textPtr[i], idLength[i]);
+    }
+
+    std::string_view description(size_t i) const {
+        return std::string_view(textPtr[i] + idLength[i], textLength[i] - idLength[i]);
+    }
+
+    // Original text of row i's date if it did not parse ("" otherwise)
+    std::string_view rawDate(size_t i) const {
+        if (rawDates.empty() || rawDates.back().first < i) return std::string_view();
+        auto it = std::lower_bound(rawDates.begin(), rawDates.end(), i,
+                                   [](const std::pair<uint32_t, std::string> &r, size_t row) { return r.first < row; });
+        return it != rawDates.end() && it->first == i ? std::string_view(it->second) : std::string_view();
+    }
+
+    // Row i's date as written: YYYY-MM-DD, or the text that did not parse
+    std::string_view dateText(size_t i, char (&buf)[10]) const {
+        if (days[i] == kNoDate) return rawDate(i);
+        return std::string_view(buf, static_cast<size_t>(formatDate(days[i], buf) - buf));
+    }
+
+    const int32_t *dayData() const { return days.data(); }
+    const int64_t *amountData() const { return amounts.data(); } // cents
+    const uint32_t *categoryData() const { return categories.data(); }
+
+    // Append row i as a CSV line (without newline) to out
+    void formatCsvRow(size_t i, std::string &out) const {
+        out.append(id(i));
+        out += ',';
+        char date[10];
+        out.append(dateText(i, date));
+        out += ',';
+        char buf[32];
+        out.append(buf, Money::fromUnits(amounts[i]).format(buf));
+        out += ',';
+        out.append(dictionary.name(categories[i]));
+        out += ',';
+        out.append(description(i));
+    }
+
+    // Build a standalone Expense for display or callers
+    Expense materialize(size_t i) const {
+        Expense e;
+        e.id = std::string(id(i));
+        char date[10];
+        e.date = std::string(dateText(i, date));
+        e.amount = Money::fromUnits(amounts[i]);
+        e.category = dictionary.name(categories[i]);
+        e.description = std::string(description(i));
+        return e;
+    }
+
+private:
+    // Carry tombstones of other's rows [first, last) over to rows starting at to
+    void copyDead(const ExpenseTable &other, size_t first, size_t last, size_t to) {
+        if (other.dead == 0) return;
+        for (size_t i = first; i < last && i < other.deadRows.size(); i++) {
+            if (other.deadRows[i]) kill(to + (i - first));
+        }
+    }
+
+    // Count and remember the text of an unparsed date of the last row
+    void keepRawDate(std::string_view text) {
+        if (text.empty()) return;
+        badDates++;
+        rawDates.emplace_back(static_cast<uint32_t>(size() - 1), std::string(text));
+    }
+
+    // Carry unparsed date text of other's rows [first, last) over to rows starting at to
+    void copyRawDates(const ExpenseTable &other, size_t first, size_t last, size_t to) {
+        for (const auto &r : other.rawDates) {
+            if (r.first >= first && r.first < last)
+                rawDates.emplace_back(static_cast<uint32_t>(to + (r.first - first)), r.second);
+        }
+    }
+
+    // Codes of other's categories in this table's dictionary
+    std::vector<uint32_t> remapFrom(const ExpenseTable &other) {
+        std::vector<uint32_t> remap(other.dictionary.size());
+        for (size_t c = 0; c < remap.size(); c++)
+            remap[c] = dictionary.intern(other.dictionary.name(static_cast<uint32_t>(c)));
+        return remap;
+    }
+};
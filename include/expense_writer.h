@@ -0,0 +1,225 @@
+// cpp/include/expense_writer.h
+#pragma once
+#include "expense.h"
+#include "expense_query.h"
+#include "date_util.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+enum class OutputFormat { Table, Csv, Json };
+
+// Formats expenses and stats into one reusable buffer and hands it to the
+// stream in large writes. Numbers go through std::to_chars and
+// Money::format, rows straight from the table columns, so nothing is
+// materialized and the stream is never flushed per row. Output is
+// complete once flush() is called or the writer is destroyed.
+class ExpenseWriter {
+private:
+    std::ostream &out;
+    OutputFormat format;
+    size_t capacity;
+    std::string buf;
+
+    void put(std::string_view s) { buf.append(s.data(), s.size()); }
+
+    void put(char c) { buf += c; }
+
+    void putCount(uint64_t n) {
+        char tmp[24];
+        buf.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), n).ptr);
+    }
+
+    void putMoney(Money m) {
+        char tmp[32];
+        buf.append(tmp, m.format(tmp));
+    }
+
+    // Left-aligned column; at least one space before the next column
+    void pad(std::string_view s, size_t width) {
+        put(s);
+        buf.append(s.size() < width ? width - s.size() : 1, ' ');
+    }
+
+    void putJsonString(std::string_view s) {
+        put('"');
+        for (char c : s) {
+            switch (c) {
+            case '"': put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char tmp[8];
+                    std::snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+                    put(tmp);
+                } else {
+                    put(c);
+                }
+            }
+        }
+        put('"');
+    }
+
+    void endRecord() {
+        put('\n');
+        if (buf.size() >= capacity) flush();
+    }
+
+public:
+    static constexpr size_t kDefaultBuffer = 1u << 20;
+
+    explicit ExpenseWriter(std::ostream &o, OutputFormat f = OutputFormat::Table,
+                           size_t bufferSize = kDefaultBuffer)
+        : out(o), format(f), capacity(bufferSize) {
+        buf.reserve(bufferSize + 4096);
+    }
+
+    ~ExpenseWriter() {
+        flush();
+    }
+
+    ExpenseWriter(const ExpenseWriter &) = delete;
+    ExpenseWriter &operator=(const ExpenseWriter &) = delete;
+
+    OutputFormat outputFormat() const { return format; }
+
+    // Column header for table and CSV output (JSON lines have none)
+    void header() {
+        if (format == OutputFormat::Csv) {
+            put("id,date,amount,category,description\n");
+        } else if (format == OutputFormat::Table) {
+            pad("ID", 8);
+            pad("Date", 12);
+            pad("Amount", 10);
+            pad("Category", 15);
+            put("Description\n");
+            buf.append(60, '-');
+            put('\n');
+        }
+    }
+
+    // One row from its fields
+    void row(std::string_view id, std::string_view date, Money amount,
+             std::string_view category, std::string_view description) {
+        switch (format) {
+        case OutputFormat::Table: {
+            pad(id, 8);
+            pad(date, 12);
+            char tmp[33] = {'$'};
+            pad(std::string_view(tmp, amount.format(tmp + 1) - tmp), 10);
+            pad(category, 15);
+            put(description);
+            break;
+        }
+        case OutputFormat::Csv:
+            put(id);
+            put(',');
+            put(date);
+            put(',');
+            putMoney(amount);
+            put(',');
+            put(category);
+            put(',');
+            put(description);
+            break;
+        case OutputFormat::Json:
+            put("{\"id\":");
+            putJsonString(id);
+            put(",\"date\":");
+            putJsonString(date);
+            put(",\"amount\":");
+            putMoney(amount);
+            put(",\"category\":");
+            putJsonString(category);
+            put(",\"description\":");
+            putJsonString(description);
+            put('}');
+            break;
+        }
+        endRecord();
+    }
+
+    // Row i of a table, formatted from its columns
+    void row(const ExpenseTable &table, size_t i) {
+        char date[10];
+        row(table.id(i), table.dateText(i, date), table.amount(i), table.categoryName(table.categoryCode(i)), table.description(i));
+    }
+
+    void row(const Expense &e) {
+        row(e.id, e.date, e.amount, e.category, e.description);
+    }
+
+    void rows(const ExpenseTable &table, const QueryResult &result) {
+        for (uint32_t i : result.rows()) row(table, i);
+    }
+
+    void statsHeader() {
+        if (format == OutputFormat::Csv) {
+            put("category,total,count,min,max,average\n");
+        } else if (format == OutputFormat::Table) {
+            pad("Category", 15);
+            pad("Total", 14);
+            pad("Count", 8);
+            pad("Min", 12);
+            pad("Max", 12);
+            put("Average\n");
+        }
+    }
+
+    void stats(const CategoryStats &s) {
+        switch (format) {
+        case OutputFormat::Table: {
+            char tmp[32];
+            pad(s.category, 15);
+            pad(std::string_view(tmp, s.total.format(tmp) - tmp), 14);
+            pad(std::string_view(tmp, std::to_chars(tmp, tmp + sizeof(tmp), s.count).ptr - tmp), 8);
+            pad(std::string_view(tmp, s.min.format(tmp) - tmp), 12);
+            pad(std::string_view(tmp, s.max.format(tmp) - tmp), 12);
+            putMoney(s.average());
+            break;
+        }
+        case OutputFormat::Csv:
+            put(s.category);
+            put(',');
+            putMoney(s.total);
+            put(',');
+            putCount(s.count);
+            put(',');
+            putMoney(s.min);
+            put(',');
+            putMoney(s.max);
+            put(',');
+            putMoney(s.average());
+            break;
+        case OutputFormat::Json:
+            put("{\"category\":");
+            putJsonString(s.category);
+            put(",\"total\":");
+            putMoney(s.total);
+            put(",\"count\":");
+            putCount(s.count);
+            put(",\"min\":");
+            putMoney(s.min);
+            put(",\"max\":");
+            putMoney(s.max);
+            put(",\"average\":");
+            putMoney(s.average());
+            put('}');
+            break;
+        }
+        endRecord();
+    }
+
+    void flush() {
+        if (buf.empty()) return;
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        out.flush();
+        buf.clear();
+    }
+};
@@ -0,0 +1,515 @@
+// cpp/include/http_server.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+#define EXPENSE_INVALID_SOCKET INVALID_SOCKET
+#define expense_poll WSAPoll
+#define expense_close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_t = int;
+#define EXPENSE_INVALID_SOCKET (-1)
+#define expense_poll poll
+#define expense_close_socket close
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define EXPENSE_SEND_FLAGS MSG_NOSIGNAL   // a closed peer must not raise SIGPIPE
+#else
+#define EXPENSE_SEND_FLAGS 0
+#endif
+
+struct HttpRequest {
+    std::string method;
+    std::string path;                               // without the query string
+    std::multimap<std::string, std::string> query;  // decoded query parameters
+    std::string body;
+
+    // First value of a query parameter, or fallback
+    std::string param(const std::string &name, const std::string &fallback = "") const {
+        auto it = query.find(name);
+        return it == query.end() ? fallback : it->second;
+    }
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string contentType = "application/json";
+    std::string body;
+};
+
+// Minimal HTTP/1.1 server for loopback use.
+//
+// One event-loop thread multiplexes the listening socket and every
+// connection with poll(): it accumulates request bytes, and once a request
+// is complete hands it to a fixed pool of worker threads. Workers run the
+// handler and queue the response; the loop is woken through a loopback UDP
+// socket, writes the response without blocking and resumes reading that
+// connection (keep-alive, one request in flight per connection).
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest &)>;
+
+    static constexpr size_t kMaxHeaderBytes = 64u << 10;
+    static constexpr size_t kMaxBodyBytes = 64u << 20;
+
+private:
+    struct Connection {
+        socket_t fd;
+        std::string in;
+        std::string out;
+        size_t sent = 0;
+        bool busy = false;       // a worker owns the current request
+        bool closeAfter = false; // close once out is sent
+        bool peerClosed = false; // peer half-closed: answer what is buffered, then close
+    };
+
+    struct Job {
+        uint64_t conn;
+        HttpRequest request;
+        bool keepAlive;
+    };
+
+    struct Done {
+        uint64_t conn;
+        std::string bytes;
+        bool keepAlive;
+    };
+
+    Handler handler;
+    socket_t listener = EXPENSE_INVALID_SOCKET;
+    socket_t wakeSocket = EXPENSE_INVALID_SOCKET;   // connected to itself
+    uint16_t boundPort = 0;
+    std::atomic<bool> stopping{false};
+
+    std::map<uint64_t, Connection> connections;
+    uint64_t nextConnection = 1;
+
+    std::mutex jobLock;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    std::mutex doneLock;
+    std::deque<Done> done;
+    std::vector<std::thread> workers;
+
+    static void setNonBlocking(socket_t fd) {
+#ifdef _WIN32
+        u_long on = 1;
+        ioctlsocket(fd, FIONBIO, &on);
+#else
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    }
+
+    static const char *reason(int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        default: return "Unknown";
+        }
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool equalsIgnoreCase(const std::string &a, const char *b) {
+        size_t n = std::strlen(b);
+        if (a.size() != n) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+                return false;
+        }
+        return true;
+    }
+
+    void wake() {
+        char b = 1;
+        send(wakeSocket, &b, 1, 0);
+    }
+
+    void workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobLock);
+                jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            HttpResponse response;
+            try {
+                response = handler(job.request);
+            } catch (const std::exception &e) {
+                response.status = 500;
+                response.body = "{\"error\":" + jsonString(e.what()) + "}";
+            }
+            std::string bytes = serialize(response, job.keepAlive);
+            {
+                std::lock_guard<std::mutex> lock(doneLock);
+                done.push_back(Done{job.conn, std::move(bytes), job.keepAlive});
+            }
+            wake();
+        }
+    }
+
+    // Parse one complete request from the front of in. Returns 1 if a request
+    // was consumed, 0 if more bytes are needed, or an HTTP error status.
+    static int parseRequest(std::string &in, HttpRequest &req, bool &keepAlive) {
+        size_t headerEnd = in.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) return in.size() > kMaxHeaderBytes ? 413 : 0;
+
+        size_t lineEnd = in.find("\r\n");
+        std::string requestLine = in.substr(0, lineEnd);
+        size_t sp1 = requestLine.find(' ');
+        size_t sp2 = requestLine.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) return 400;
+        req.method = requestLine.substr(0, sp1);
+        std::string target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+        keepAlive = requestLine.compare(sp2 + 1, std::string::npos, "HTTP/1.0") != 0;
+
+        size_t contentLength = 0;
+        size_t pos = lineEnd + 2;
+        while (pos < headerEnd) {
+            size_t end = in.find("\r\n", pos);
+            size_t colon = in.find(':', pos);
+            if (colon != std::string::npos && colon < end) {
+                std::string name = in.substr(pos, colon - pos);
+                size_t v = in.find_first_not_of(' ', colon + 1);
+                std::string value = in.substr(v, end - v);
+                if (equalsIgnoreCase(name, "Content-Length")) {
+                    contentLength = std::strtoull(value.c_str(), nullptr, 10);
+                } else if (equalsIgnoreCase(name, "Connection")) {
+                    if (equalsIgnoreCase(value, "close")) keepAlive = false;
+                    else if (equalsIgnoreCase(value, "keep-alive")) keepAlive = true;
+                }
+            }
+            pos = end + 2;
+        }
+        if (contentLength > kMaxBodyBytes) return 413;
+        size_t total = headerEnd + 4 + contentLength;
+        if (in.size() < total) return 0;
+
+        req.body = in.substr(headerEnd + 4, contentLength);
+        size_t q = target.find('?');
+        req.path = decode(target.substr(0, q));
+        req.query.clear();
+        if (q != std::string::npos) parseQuery(target.substr(q + 1), req.query);
+        in.erase(0, total);
+        return 1;
+    }
+
+    static std::string serialize(const HttpResponse &r, bool keepAlive) {
+        std::string s = "HTTP/1.1 " + std::to_string(r.status) + " " + reason(r.status) + "\r\n";
+        s += "Content-Type: " + r.contentType + "\r\n";
+        s += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+        s += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        s += r.body;
+        return s;
+    }
+
+    void closeConnection(uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end()) return;
+        expense_close_socket(it->second.fd);
+        connections.erase(it);
+    }
+
+    // Send what is pending; returns false if the connection was closed
+    bool flushConnection(uint64_t id, Connection &c) {
+        while (c.sent < c.out.size()) {
+            int n = send(c.fd, c.out.data() + c.sent, static_cast<int>(c.out.size() - c.sent), EXPENSE_SEND_FLAGS);
+            if (n <= 0) {
+#ifdef _WIN32
+                if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK) return true;
+#else
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+#endif
+                closeConnection(id);
+                return false;
+            }
+            c.sent += static_cast<size_t>(n);
+        }
+        c.out.clear();
+        c.sent = 0;
+        if (c.closeAfter) {
+            closeConnection(id);
+            return false;
+        }
+        return true;
+    }
+
+    // Hand the next buffered request of a connection to the workers
+    void dispatch(uint64_t id, Connection &c) {
+        if (c.busy || !c.out.empty()) return;
+        HttpRequest req;
+        bool keepAlive = true;
+        int status = parseRequest(c.in, req, keepAlive);
+        if (status == 0) {
+            // Nothing complete is left and no more bytes will come
+            if (c.peerClosed) closeConnection(id);
+            return;
+        }
+        if (status != 1) {
+            HttpResponse error;
+            error.status = status;
+            error.body = "{\"error\":\"" + std::string(reason(status)) + "\"}";
+            c.out = serialize(error, false);
+            c.closeAfter = true;
+            flushConnection(id, c);
+            return;
+        }
+        c.busy = true;
+        {
+            std::lock_guard<std::mutex> lock(jobLock);
+            jobs.push_back(Job{id, std::move(req), keepAlive});
+        }
+        jobReady.notify_one();
+    }
+
+    void acceptAll() {
+        while (true) {
+            socket_t fd = accept(listener, nullptr, nullptr);
+            if (fd == EXPENSE_INVALID_SOCKET) return;
+            setNonBlocking(fd);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&one), sizeof(one));
+            Connection c;
+            c.fd = fd;
+            connections.emplace(nextConnection++, std::move(c));
+        }
+    }
+
+    void readConnection(uint64_t id, Connection &c) {
+        char buf[64 * 1024];
+        while (true) {
+            int n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.in.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+#ifdef _WIN32
+            if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK) break;
+#else
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+#endif
+            if (n < 0) {
+                closeConnection(id);
+                return;
+            }
+            c.peerClosed = true; // requests already buffered still get answers
+            break;
+        }
+        dispatch(id, c);
+    }
+
+    void completeResponses() {
+        char drain[256];
+        while (recv(wakeSocket, drain, sizeof(drain), 0) > 0) {}
+
+        std::deque<Done> ready;
+        {
+            std::lock_guard<std::mutex> lock(doneLock);
+            ready.swap(done);
+        }
+        for (Done &d : ready) {
+            auto it = connections.find(d.conn);
+            if (it == connections.end()) continue; // client went away
+            Connection &c = it->second;
+            c.busy = false;
+            c.out = std::move(d.bytes);
+            c.sent = 0;
+            c.closeAfter = !d.keepAlive;
+            if (flushConnection(d.conn, c)) dispatch(d.conn, c);
+        }
+    }
+
+public:
+    explicit HttpServer(Handler h) : handler(std::move(h)) {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    }
+
+    ~HttpServer() {
+        stop();
+        for (auto &w : workers) w.join();
+        for (auto &entry : connections) expense_close_socket(entry.second.fd);
+        if (listener != EXPENSE_INVALID_SOCKET) expense_close_socket(listener);
+        if (wakeSocket != EXPENSE_INVALID_SOCKET) expense_close_socket(wakeSocket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    // s as a quoted JSON string (control characters are dropped)
+    static std::string jsonString(const std::string &s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) out += c;
+        }
+        return out + "\"";
+    }
+
+    // Decode %XX escapes (and '+' as space in query strings)
+    static std::string decode(const std::string &s, bool plusIsSpace = false) {
+        std::string out;
+        out.reserve(s.size());
+        for (size_t i = 0; i < s.size(); i++) {
+            if (s[i] == '%' && i + 2 < s.size() && hexValue(s[i + 1]) >= 0 && hexValue(s[i + 2]) >= 0) {
+                out += static_cast<char>(hexValue(s[i + 1]) * 16 + hexValue(s[i + 2]));
+                i += 2;
+            } else if (s[i] == '+' && plusIsSpace) {
+                out += ' ';
+            } else {
+                out += s[i];
+            }
+        }
+        return out;
+    }
+
+    static void parseQuery(const std::string &qs, std::multimap<std::string, std::string> &out) {
+        size_t pos = 0;
+        while (pos <= qs.size()) {
+            size_t amp = qs.find('&', pos);
+            if (amp == std::string::npos) amp = qs.size();
+            std::string pair = qs.substr(pos, amp - pos);
+            if (!pair.empty()) {
+                size_t eq = pair.find('=');
+                if (eq == std::string::npos) out.emplace(decode(pair, true), "");
+                else out.emplace(decode(pair.substr(0, eq), true), decode(pair.substr(eq + 1), true));
+            }
+            pos = amp + 1;
+        }
+    }
+
+    // Bind to 127.0.0.1:port (0 picks a free port); false on failure
+    bool listen(uint16_t port) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == EXPENSE_INVALID_SOCKET) return false;
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&one), sizeof(one));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener, SOMAXCONN) != 0) return false;
+        socklen_t len = sizeof(addr);
+        getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+        boundPort = ntohs(addr.sin_port);
+        setNonBlocking(listener);
+
+        // Workers wake the loop by sending a byte to this socket
+        wakeSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (wakeSocket == EXPENSE_INVALID_SOCKET) return false;
+        sockaddr_in wakeAddr;
+        std::memset(&wakeAddr, 0, sizeof(wakeAddr));
+        wakeAddr.sin_family = AF_INET;
+        wakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        len = sizeof(wakeAddr);
+        if (bind(wakeSocket, reinterpret_cast<sockaddr *>(&wakeAddr), sizeof(wakeAddr)) != 0 ||
+            getsockname(wakeSocket, reinterpret_cast<sockaddr *>(&wakeAddr), &len) != 0 ||
+            connect(wakeSocket, reinterpret_cast<sockaddr *>(&wakeAddr), sizeof(wakeAddr)) != 0)
+            return false;
+        setNonBlocking(wakeSocket);
+        return true;
+    }
+
+    uint16_t port() const { return boundPort; }
+
+    // Serve until stop() is called; threads = worker pool size (0 = one per core)
+    void run(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 0; t < threads; t++) workers.emplace_back([this] { workerLoop(); });
+
+        std::vector<pollfd> fds;
+        std::vector<uint64_t> ids;
+        while (!stopping) {
+            fds.clear();
+            ids.clear();
+            fds.push_back(pollfd{listener, POLLIN, 0});
+            fds.push_back(pollfd{wakeSocket, POLLIN, 0});
+            for (auto &entry : connections) {
+                short events = 0;
+                if (!entry.second.out.empty()) events |= POLLOUT;
+                else if (!entry.second.busy && !entry.second.peerClosed) events |= POLLIN;
+                if (!events) continue;
+                fds.push_back(pollfd{entry.second.fd, events, 0});
+                ids.push_back(entry.first);
+            }
+            // The timeout only bounds how long a stop() request can go unnoticed
+            if (expense_poll(fds.data(), static_cast<unsigned long>(fds.size()), 250) <= 0) continue;
+            if (stopping) break;
+
+            if (fds[1].revents) completeResponses();
+            if (fds[0].revents & POLLIN) acceptAll();
+            for (size_t k = 2; k < fds.size(); k++) {
+                if (!fds[k].revents) continue;
+                auto it = connections.find(ids[k - 2]);
+                if (it == connections.end()) continue;
+                if (fds[k].revents & POLLOUT) {
+                    if (flushConnection(it->first, it->second)) dispatch(it->first, it->second);
+                } else {
+                    readConnection(it->first, it->second);
+                }
+            }
+        }
+        stop();
+    }
+
+    // Ask run() to return; only sets a flag, so it is safe from a signal handler
+    void requestStop() {
+        stopping = true;
+    }
+
+    // Ask run() to return; safe from any thread
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(jobLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        if (wakeSocket != EXPENSE_INVALID_SOCKET) wake();
+    }
+};
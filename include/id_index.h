@@ -0,0 +1,160 @@
+// cpp/include/id_index.h
+#pragma once
+#include "expense_table.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Issues expense ids "E<n>" from a sequence that starts above every id the
+// store has seen, so new ids never collide with loaded ones. Safe to call
+// from several threads at once.
+class IdGenerator {
+private:
+    std::atomic<uint64_t> next{1};
+
+public:
+    // Numeric value of an "E<digits>" id, or 0 if it has another shape
+    static uint64_t sequenceOf(std::string_view id) {
+        if (id.size() < 2 || id.size() > 19 || id[0] != 'E') return 0;
+        uint64_t n = 0;
+        for (size_t i = 1; i < id.size(); i++) {
+            if (id[i] < '0' || id[i] > '9') return 0;
+            n = n * 10 + static_cast<uint64_t>(id[i] - '0');
+        }
+        return n;
+    }
+
+    // Make sure later ids sort after id
+    void observe(std::string_view id) {
+        uint64_t n = sequenceOf(id);
+        if (n == 0) return;
+        uint64_t cur = next.load(std::memory_order_relaxed);
+        while (cur <= n && !next.compare_exchange_weak(cur, n + 1, std::memory_order_relaxed)) {}
+    }
+
+    std::string generate() {
+        return "E" + std::to_string(next.fetch_add(1, std::memory_order_relaxed));
+    }
+};
+
+// Hash index from expense id to row, for O(1) lookup and duplicate checks.
+//
+// Open addressing with linear probing over row numbers only: keys are not
+// copied, a probe compares against the id stored in the table (arena views
+// are stable, so the index never has to be rebuilt when rows are appended).
+// The table is kept at most half full. Rows with an empty id are not indexed.
+//
+// A row whose id is already indexed is kept aside as shadowed: lookups
+// return the first row, and once that row is erased the next one with the
+// same id takes its place, so every duplicate can still be found in turn.
+class IdIndex {
+public:
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    std::vector<uint32_t> slots;   // row number or kEmpty; size is a power of two
+    size_t count = 0;
+    std::vector<uint32_t> shadowed; // rows hidden behind an earlier row with their id, in row order
+
+    static uint64_t hash(std::string_view s) {
+        uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+        for (char c : s) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        return h ^ (h >> 32);
+    }
+
+    size_t mask() const { return slots.size() - 1; }
+
+    void grow(const ExpenseTable &table) {
+        std::vector<uint32_t> old(slots.size() < 16 ? 32 : slots.size() * 2, kEmpty);
+        old.swap(slots);
+        for (uint32_t row : old) {
+            if (row == kEmpty) continue;
+            size_t k = hash(table.id(row)) & mask();
+            while (slots[k] != kEmpty) k = (k + 1) & mask();
+            slots[k] = row;
+        }
+    }
+
+public:
+    size_t size() const { return count; }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+        shadowed.clear();
+    }
+
+    size_t duplicateCount() const { return shadowed.size(); }
+
+    // Index rows [first, last) of table; returns how many were duplicates
+    // (duplicates are shadowed, so lookups return the first row)
+    size_t addRange(const ExpenseTable &table, size_t first, size_t last) {
+        size_t duplicates = 0;
+        for (size_t i = first; i < last; i++) {
+            if (insert(table, static_cast<uint32_t>(i)) != kNotFound) duplicates++;
+        }
+        return duplicates;
+    }
+
+    // Index row; returns the row already holding its id, or kNotFound if added
+    uint32_t insert(const ExpenseTable &table, uint32_t row) {
+        std::string_view id = table.id(row);
+        if (id.empty()) return kNotFound;
+        if ((count + 1) * 2 > slots.size()) grow(table);
+        size_t k = hash(id) & mask();
+        while (slots[k] != kEmpty) {
+            if (table.id(slots[k]) == id) {
+                shadowed.push_back(row);
+                return slots[k];
+            }
+            k = (k + 1) & mask();
+        }
+        slots[k] = row;
+        count++;
+        return kNotFound;
+    }
+
+    // Row holding id, or kNotFound
+    uint32_t find(const ExpenseTable &table, std::string_view id) const {
+        if (slots.empty() || id.empty()) return kNotFound;
+        size_t k = hash(id) & mask();
+        while (slots[k] != kEmpty) {
+            if (table.id(slots[k]) == id) return slots[k];
+            k = (k + 1) & mask();
+        }
+        return kNotFound;
+    }
+
+    // Drop id from the index (backward-shift deletion keeps probes tombstone-free)
+    bool erase(const ExpenseTable &table, std::string_view id) {
+        if (slots.empty() || id.empty()) return false;
+        size_t k = hash(id) & mask();
+        while (slots[k] != kEmpty && table.id(slots[k]) != id) k = (k + 1) & mask();
+        if (slots[k] == kEmpty) return false;
+        size_t hole = k;
+        for (size_t j = (k + 1) & mask(); slots[j] != kEmpty; j = (j + 1) & mask()) {
+            size_t home = hash(table.id(slots[j])) & mask();
+            // Move j into the hole unless its home lies cyclically in (hole, j]
+            bool stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+            if (!stays) {
+                slots[hole] = slots[j];
+                hole = j;
+            }
+        }
+        slots[hole] = kEmpty;
+        count--;
+
+        // The next row with this id (if any) becomes the indexed one
+        for (auto it = shadowed.begin(); it != shadowed.end(); ++it) {
+            if (table.id(*it) != id) continue;
+            uint32_t next = *it;
+            shadowed.erase(it);
+            insert(table, next);
+            break;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,139 @@
+// cpp/include/money.h
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <iostream>
+
+constexpr int64_t pow10i(int n) {
+    return n <= 0 ? 1 : 10 * pow10i(n - 1);
+}
+
+// Exact fixed-point amount: an integer count of 10^-Decimals units.
+// Sums are plain integer additions, so totals never drift and a value
+// written to CSV reads back bit-identical.
+template <int Decimals>
+class FixedDecimal {
+public:
+    static constexpr int64_t kScale = pow10i(Decimals);
+
+private:
+    int64_t units = 0;
+
+public:
+    constexpr FixedDecimal() = default;
+
+    // Implicit so literals like 25.50 keep working; rounds half away from zero
+    FixedDecimal(double value) : units(static_cast<int64_t>(std::llround(value * kScale))) {}
+
+    static constexpr FixedDecimal fromUnits(int64_t u) {
+        FixedDecimal m;
+        m.units = u;
+        return m;
+    }
+
+    constexpr int64_t raw() const { return units; }
+    double toDouble() const { return static_cast<double>(units) / kScale; }
+
+    FixedDecimal &operator+=(FixedDecimal o) { units += o.units; return *this; }
+    FixedDecimal &operator-=(FixedDecimal o) { units -= o.units; return *this; }
+    friend FixedDecimal operator+(FixedDecimal a, FixedDecimal b) { return a += b; }
+    friend FixedDecimal operator-(FixedDecimal a, FixedDecimal b) { return a -= b; }
+    friend FixedDecimal operator-(FixedDecimal a) { return fromUnits(-a.units); }
+
+    friend bool operator==(FixedDecimal a, FixedDecimal b) { return a.units == b.units; }
+    friend bool operator!=(FixedDecimal a, FixedDecimal b) { return a.units != b.units; }
+    friend bool operator<(FixedDecimal a, FixedDecimal b) { return a.units < b.units; }
+    friend bool operator>(FixedDecimal a, FixedDecimal b) { return a.units > b.units; }
+    friend bool operator<=(FixedDecimal a, FixedDecimal b) { return a.units <= b.units; }
+    friend bool operator>=(FixedDecimal a, FixedDecimal b) { return a.units >= b.units; }
+
+    // Parse [blanks][+|-]digits[.digits] without going through double.
+    // Extra fraction digits are rounded half away from zero and trailing
+    // text is ignored (as std::stod does). Returns false if no number.
+    static bool parse(std::string_view s, FixedDecimal &out) {
+        size_t i = 0, n = s.size();
+        while (i < n && (s[i] == ' ' || s[i] == '\t')) i++;
+        bool negative = false;
+        if (i < n && (s[i] == '+' || s[i] == '-')) negative = s[i++] == '-';
+
+        int64_t whole = 0;
+        size_t digits = 0;
+        for (; i < n && s[i] >= '0' && s[i] <= '9'; i++, digits++) {
+            if (digits >= 15) return false; // would overflow the unit count
+            whole = whole * 10 + (s[i] - '0');
+        }
+
+        int64_t frac = 0;
+        int fracDigits = 0;
+        bool roundUp = false;
+        if (i < n && s[i] == '.') {
+            for (i++; i < n && s[i] >= '0' && s[i] <= '9'; i++, digits++) {
+                if (fracDigits < Decimals) {
+                    frac = frac * 10 + (s[i] - '0');
+                    fracDigits++;
+                } else if (fracDigits == Decimals) {
+                    roundUp = s[i] >= '5';
+                    fracDigits++;
+                }
+            }
+        }
+        if (digits == 0) return false;
+
+        // Rare exponent form: fall back to a double parse
+        if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+            double value = 0.0;
+            size_t start = s.find_first_not_of(" \t+");
+            auto res = std::from_chars(s.data() + start, s.data() + n, value);
+            if (res.ec != std::errc() || std::fabs(value) > 9.0e15) return false;
+            out = FixedDecimal(value);
+            return true;
+        }
+
+        for (int d = fracDigits; d < Decimals; d++) frac *= 10;
+        int64_t u = whole * kScale + frac + (roundUp ? 1 : 0);
+        out = fromUnits(negative ? -u : u);
+        return true;
+    }
+
+    // Write "-123.45" into buf (needs 24 + Decimals bytes); returns the end
+    char *format(char *buf) const {
+        char *p = buf;
+        uint64_t u = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+        if (units < 0) *p++ = '-';
+        p = std::to_chars(p, p + 20, u / kScale).ptr;
+        if (Decimals > 0) {
+            *p++ = '.';
+            uint64_t frac = u % kScale;
+            for (int64_t div = kScale / 10; div > 0; div /= 10) {
+                *p++ = static_cast<char>('0' + frac / div % 10);
+            }
+        }
+        return p;
+    }
+
+    std::string toString() const {
+        char buf[32 + Decimals];
+        return std::string(buf, format(buf));
+    }
+};
+
+// Amounts are stored in integer cents
+using Money = FixedDecimal<2>;
+
+template <int Decimals>
+std::ostream &operator<<(std::ostream &os, FixedDecimal<Decimals> m) {
+    return os << m.toString();
+}
+
+template <int Decimals>
+std::istream &operator>>(std::istream &is, FixedDecimal<Decimals> &m) {
+    std::string token;
+    if (!(is >> token)) return is;
+    FixedDecimal<Decimals> value;
+    if (FixedDecimal<Decimals>::parse(token, value)) m = value;
+    else is.setstate(std::ios::failbit);
+    return is;
+}
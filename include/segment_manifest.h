@@ -0,0 +1,219 @@
+// cpp/include/segment_manifest.h
+#pragma once
+#include "date_util.h"
+#include "csv_scanner.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// One segment file of a partitioned ledger: the rows dated in one period
+struct SegmentInfo {
+    int32_t period = kNoDate;   // first day of the period; kNoDate holds undated rows
+    std::string file;           // name inside the ledger directory
+    unsigned generation = 0;    // bumped each time the file is rewritten
+    size_t rows = 0;
+    int32_t minDay = kNoDate;   // date range actually present (kNoDate if undated)
+    int32_t maxDay = kNoDate;
+};
+
+// Table of contents of a ledger stored as a directory of CSV segments.
+//
+// Rows are partitioned by date into periods of a fixed number of months;
+// each period is its own CSV file (with the usual header), so a date-range
+// query opens only the segments whose [minDay, maxDay] overlaps it and an
+// add touches only the segment of its date.
+//
+// A segment whose period lies before the current one is sealed: its file is
+// never written in place again. A change to it is written to a new file
+// (the next generation), the manifest is switched over, and only then is
+// the old file removed, so any file name always has the same contents and
+// can be cached, mapped or compressed on its own. The open (current or
+// later) segments take new rows by appending. Sealed segments may be
+// stored compressed (.col files, see ColumnarSegment) instead of as CSV.
+//
+// The manifest itself is a small CSV file, replaced via a temp file:
+//   #segments months=1
+//   period,file,generation,rows,min,max
+//   2024-01,2024-01.csv,0,412,2024-01-01,2024-01-31
+class SegmentManifest {
+private:
+    std::string dir;
+    unsigned months = 1;
+    std::vector<SegmentInfo> segments;  // ordered by period (undated first)
+
+    std::vector<SegmentInfo>::iterator lowerBound(int32_t period) {
+        return std::lower_bound(segments.begin(), segments.end(), period,
+                                [](const SegmentInfo &s, int32_t p) { return s.period < p; });
+    }
+
+public:
+    static constexpr const char *kFileName = "manifest.csv";
+
+    SegmentManifest() = default;
+    SegmentManifest(const std::string &directory, unsigned monthsPerSegment)
+        : dir(directory), months(monthsPerSegment == 0 ? 1 : monthsPerSegment) {}
+
+    static std::string manifestPath(const std::string &directory) {
+        return directory + "/" + kFileName;
+    }
+
+    // True if directory holds a segmented ledger
+    static bool exists(const std::string &directory) {
+        struct stat st;
+        return stat(manifestPath(directory).c_str(), &st) == 0;
+    }
+
+    static bool makeDirectory(const std::string &directory) {
+        struct stat st;
+        if (stat(directory.c_str(), &st) == 0) return true;
+#ifdef _WIN32
+        return _mkdir(directory.c_str()) == 0;
+#else
+        return mkdir(directory.c_str(), 0755) == 0;
+#endif
+    }
+
+    const std::string &directory() const { return dir; }
+    std::string path() const { return manifestPath(dir); }
+    std::string pathOf(const SegmentInfo &s) const { return dir + "/" + s.file; }
+    unsigned monthsPerSegment() const { return months; }
+    const std::vector<SegmentInfo> &all() const { return segments; }
+    size_t size() const { return segments.size(); }
+
+    void clear() { segments.clear(); }
+
+    // First day of the period holding day (kNoDate stays kNoDate)
+    int32_t periodOf(int32_t day) const {
+        if (day == kNoDate) return kNoDate;
+        int y, m, d;
+        civilFromDays(day, y, m, d);
+        int index = (y * 12 + (m - 1)) / static_cast<int>(months) * static_cast<int>(months);
+        return daysFromCivil(index / 12, index % 12 + 1, 1);
+    }
+
+    // Last day of the period starting at period
+    int32_t periodEnd(int32_t period) const {
+        if (period == kNoDate) return kNoDate;
+        int y, m, d;
+        civilFromDays(period, y, m, d);
+        int index = y * 12 + (m - 1) + static_cast<int>(months);
+        return daysFromCivil(index / 12, index % 12 + 1, 1) - 1;
+    }
+
+    // "YYYY-MM" of the period's first month, or "undated"
+    static std::string periodName(int32_t period) {
+        return period == kNoDate ? std::string("undated") : formatDate(period).substr(0, 7);
+    }
+
+    // Periods before the one holding today are sealed; undated rows never are
+    bool sealed(int32_t period, int32_t today) const {
+        return period != kNoDate && period < periodOf(today);
+    }
+
+    SegmentInfo *find(int32_t period) {
+        auto it = lowerBound(period);
+        return it != segments.end() && it->period == period ? &*it : nullptr;
+    }
+
+    // Entry for period, added (empty, file not yet written) if missing
+    SegmentInfo &get(int32_t period) {
+        auto it = lowerBound(period);
+        if (it != segments.end() && it->period == period) return *it;
+        SegmentInfo s;
+        s.period = period;
+        s.file = fileName(period, 0);
+        return *segments.insert(it, s);
+    }
+
+    void erase(int32_t period) {
+        auto it = lowerBound(period);
+        if (it != segments.end() && it->period == period) segments.erase(it);
+    }
+
+    // File of a period's generation: CSV, or with columnar the compressed
+    // column encoding (ColumnarSegment)
+    static std::string fileName(int32_t period, unsigned generation, bool columnar = false) {
+        std::string name = periodName(period);
+        if (generation > 0) name += "." + std::to_string(generation);
+        return name + (columnar ? ".col" : ".csv");
+    }
+
+    static bool isColumnar(const std::string &file) {
+        return file.size() >= 4 && file.compare(file.size() - 4, 4, ".col") == 0;
+    }
+
+    // Segments that may hold rows dated from..to (inclusive)
+    std::vector<const SegmentInfo *> overlapping(int32_t from, int32_t to) const {
+        std::vector<const SegmentInfo *> result;
+        for (const SegmentInfo &s : segments) {
+            if (s.rows == 0 || s.period == kNoDate) continue;
+            if (s.maxDay >= from && s.minDay <= to) result.push_back(&s);
+        }
+        return result;
+    }
+
+    // Load the manifest of dir; false if it is missing or unreadable
+    bool read() {
+        segments.clear();
+        std::ifstream in(path(), std::ios::binary);
+        if (!in.is_open()) return false;
+        std::string line;
+        if (!std::getline(in, line) || line.compare(0, 17, "#segments months=") != 0) {
+            std::cerr << "Warning: " << path() << " is not a segment manifest.\n";
+            return false;
+        }
+        unsigned long n = std::strtoul(line.c_str() + 17, nullptr, 10);
+        months = n == 0 ? 1 : static_cast<unsigned>(n);
+        std::getline(in, line); // column names
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            std::string_view rest = line;
+            std::string_view period = nextCsvField(rest);
+            SegmentInfo s;
+            s.period = period == "undated" ? kNoDate : parseDate(std::string(period) + "-01");
+            s.file = std::string(nextCsvField(rest));
+            s.generation = static_cast<unsigned>(std::strtoul(std::string(nextCsvField(rest)).c_str(), nullptr, 10));
+            s.rows = static_cast<size_t>(std::strtoull(std::string(nextCsvField(rest)).c_str(), nullptr, 10));
+            s.minDay = parseDate(nextCsvField(rest));
+            s.maxDay = parseDate(nextCsvField(rest));
+            if (s.file.empty() || (s.period == kNoDate && period != "undated")) continue;
+            segments.insert(lowerBound(s.period), s);
+        }
+        return true;
+    }
+
+    // Replace the manifest file (via a temp file and rename)
+    bool write() const {
+        std::string out = "#segments months=" + std::to_string(months) + "\n";
+        out += "period,file,generation,rows,min,max\n";
+        for (const SegmentInfo &s : segments) {
+            out += periodName(s.period);
+            out += ',' + s.file + ',' + std::to_string(s.generation) + ',' + std::to_string(s.rows) + ',';
+            out += formatDate(s.minDay) + ',' + formatDate(s.maxDay) + '\n';
+        }
+
+        std::string target = path();
+        std::string tmpPath = target + ".tmp";
+        std::FILE *f = std::fopen(tmpPath.c_str(), "wb");
+        bool ok = f && std::fwrite(out.data(), 1, out.size(), f) == out.size();
+        ok = f && std::fclose(f) == 0 && ok;
+#ifdef _WIN32
+        if (ok) std::remove(target.c_str()); // rename() does not replace files on Windows
+#endif
+        if (!ok || std::rename(tmpPath.c_str(), target.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            std::cerr << "Error: Could not write segment manifest " << target << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,130 @@
+// cpp/include/string_arena.h
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for the text of one generation of expenses.
+//
+// Text is copied into large slabs that never move, so a view into the
+// arena stays valid while more rows are appended and until clear(). A
+// whole load costs a handful of slab allocations instead of one per
+// field, and clear() just rewinds: the slabs are kept for the next
+// generation, so reloading neither frees nor reallocates per row.
+class StringArena {
+private:
+    struct Slab {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    std::vector<Slab> slabs;   // slabs[active] is being filled; later ones are spare
+    size_t active = 0;
+    size_t usedBytes = 0;
+    size_t slabSize;
+    uint64_t gen = 0;
+
+    // Make room for n bytes in the active slab
+    void ensure(size_t n) {
+        if (active < slabs.size() && slabs[active].size - slabs[active].used >= n) return;
+        // Move on to a spare slab that fits, else allocate one
+        for (size_t k = slabs.empty() ? 0 : active + 1; k < slabs.size(); k++) {
+            if (slabs[k].size >= n) {
+                std::swap(slabs[active + 1], slabs[k]);
+                active++;
+                return;
+            }
+        }
+        Slab s;
+        s.size = n > slabSize ? n : slabSize;
+        s.data.reset(new char[s.size]);
+        if (slabs.empty()) {
+            slabs.push_back(std::move(s));
+            active = 0;
+        } else {
+            slabs.insert(slabs.begin() + static_cast<std::ptrdiff_t>(active + 1), std::move(s));
+            active++;
+        }
+    }
+
+public:
+    static constexpr size_t kDefaultSlab = 1u << 20;
+
+    explicit StringArena(size_t slabBytes = kDefaultSlab) : slabSize(slabBytes) {}
+
+    StringArena(StringArena &&) = default;
+    StringArena &operator=(StringArena &&) = default;
+    StringArena(const StringArena &) = delete;            // views would point into the source
+    StringArena &operator=(const StringArena &) = delete;
+
+    // Bytes handed out in this generation
+    size_t size() const { return usedBytes; }
+
+    // Bytes held, including spare slabs kept for reuse
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Slab &s : slabs) total += s.size;
+        return total;
+    }
+
+    // Bumped by clear(); views from an older generation are invalid
+    uint64_t generation() const { return gen; }
+
+    // Make sure n more bytes fit without another allocation
+    void reserve(size_t n) {
+        ensure(n);
+    }
+
+    // Uninitialized space for n bytes, stable until clear()
+    char *allocate(size_t n) {
+        ensure(n);
+        Slab &s = slabs[active];
+        char *p = s.data.get() + s.used;
+        s.used += n;
+        usedBytes += n;
+        return p;
+    }
+
+    // Copy a followed by b into the arena; returns the start
+    const char *store(std::string_view a, std::string_view b = std::string_view()) {
+        char *p = allocate(a.size() + b.size());
+        if (!a.empty()) std::memcpy(p, a.data(), a.size());
+        if (!b.empty()) std::memcpy(p + a.size(), b.data(), b.size());
+        return p;
+    }
+
+    // Take over other's slabs; views into other stay valid and now belong here
+    void adopt(StringArena &&other) {
+        for (size_t k = 0; k < other.slabs.size(); k++) {
+            if (other.slabs[k].used == 0) continue;
+            // Filled slabs go before the active one so allocation continues here
+            slabs.insert(slabs.begin() + static_cast<std::ptrdiff_t>(slabs.empty() ? 0 : active),
+                         std::move(other.slabs[k]));
+            if (slabs.size() > 1) active++;
+        }
+        usedBytes += other.usedBytes;
+        other.slabs.clear();
+        other.active = 0;
+        other.usedBytes = 0;
+        other.gen++;
+    }
+
+    // Start a new generation; slabs are kept for reuse
+    void clear() {
+        for (size_t k = 0; k <= active && k < slabs.size(); k++) slabs[k].used = 0;
+        active = 0;
+        usedBytes = 0;
+        gen++;
+    }
+
+    // Start a new generation and return the memory
+    void release() {
+        slabs.clear();
+        active = 0;
+        usedBytes = 0;
+        gen++;
+    }
+};
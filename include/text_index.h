@@ -0,0 +1,315 @@
+// cpp/include/text_index.h
+#pragma once
+#include "expense_table.h"
+#include "string_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One word of a full-text query; prefix matches every word starting with it
+struct TextTerm {
+    std::string word;   // lower case
+    bool prefix = false;
+};
+
+// Call fn(std::string_view) for each word of text, lower-cased. Words are
+// runs of ASCII letters and digits; bytes of multi-byte UTF-8 characters
+// count as letters, so non-English words stay whole.
+template <typename Fn>
+void forEachWord(std::string_view text, Fn &&fn) {
+    std::string lowered;
+    size_t i = 0;
+    while (i < text.size()) {
+        // Find the next run of letters; words already in lower case are
+        // passed as views into text, the others through one reused buffer
+        size_t start = i;
+        bool upper = false;
+        for (; i < text.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            bool isUpper = c >= 'A' && c <= 'Z';
+            if (!(isUpper || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80)) break;
+            upper |= isUpper;
+        }
+        if (i > start) {
+            std::string_view word = text.substr(start, i - start);
+            if (upper) {
+                lowered.assign(word.data(), word.size());
+                for (char &c : lowered) {
+                    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                }
+                word = lowered;
+            }
+            fn(word);
+        }
+        i++;
+    }
+}
+
+// Split a search string into terms; a trailing '*' makes a word a prefix
+inline std::vector<TextTerm> parseTextTerms(std::string_view query) {
+    std::vector<TextTerm> terms;
+    size_t i = 0;
+    while (i < query.size()) {
+        size_t end = query.find(' ', i);
+        if (end == std::string_view::npos) end = query.size();
+        std::string_view piece = query.substr(i, end - i);
+        bool prefix = !piece.empty() && piece.back() == '*';
+        size_t first = terms.size();
+        forEachWord(piece, [&terms](std::string_view w) { terms.push_back(TextTerm{std::string(w), false}); });
+        if (prefix && terms.size() > first) terms.back().prefix = true;
+        i = end + 1;
+    }
+    return terms;
+}
+
+// Inverted index over expense descriptions: word -> rows containing it.
+//
+// Each posting list holds ascending row numbers as varint-encoded gaps, so
+// a common word costs about one byte per row. A query decodes only the
+// lists of its words: AND intersects them starting from the shortest,
+// OR and prefix terms merge them. Rows are appended in increasing order,
+// so adds extend the lists in place; tombstoned rows stay listed and are
+// filtered by the caller.
+//
+// Words are interned like ids in IdIndex: an open-addressing table of word
+// numbers over text kept in a StringArena, so building never allocates per
+// word beyond its posting list.
+class TextIndex {
+private:
+    struct Postings {
+        std::vector<uint8_t> gaps;  // varint(row - next) per row
+        uint32_t next = 0;          // one past the last row listed
+        uint32_t rows = 0;
+    };
+
+    struct Slot {
+        uint32_t hash = 0;
+        uint32_t word = kEmpty;
+    };
+
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    StringArena text;                       // word text
+    std::vector<std::string_view> words;    // word number -> text
+    std::vector<Postings> postings;         // word number -> rows
+    std::vector<Slot> slots;                // open addressing; size is a power of two
+    std::vector<uint32_t> vocabulary;       // word numbers in text order (for prefixes)
+    size_t encodedBytes = 0;
+
+    static uint32_t hash(std::string_view s) {
+        uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+        for (char c : s) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() < 16 ? 64 : slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Slot &s : old) {
+            if (s.word == kEmpty) continue;
+            size_t k = s.hash & mask;
+            while (slots[k].word != kEmpty) k = (k + 1) & mask;
+            slots[k] = s;
+        }
+    }
+
+    // Number of word, or kEmpty
+    uint32_t find(std::string_view word) const {
+        if (slots.empty()) return kEmpty;
+        uint32_t h = hash(word);
+        size_t mask = slots.size() - 1;
+        for (size_t k = h & mask; slots[k].word != kEmpty; k = (k + 1) & mask) {
+            if (slots[k].hash == h && words[slots[k].word] == word) return slots[k].word;
+        }
+        return kEmpty;
+    }
+
+    // Number of word, added (and reported in fresh) if it is new
+    uint32_t intern(std::string_view word, std::vector<uint32_t> &fresh) {
+        if ((words.size() + 1) * 2 > slots.size()) grow();
+        uint32_t h = hash(word);
+        size_t mask = slots.size() - 1;
+        size_t k = h & mask;
+        for (; slots[k].word != kEmpty; k = (k + 1) & mask) {
+            if (slots[k].hash == h && words[slots[k].word] == word) return slots[k].word;
+        }
+        uint32_t n = static_cast<uint32_t>(words.size());
+        words.push_back(std::string_view(text.store(word), word.size()));
+        postings.emplace_back();
+        slots[k] = Slot{h, n};
+        fresh.push_back(n);
+        return n;
+    }
+
+    void addWord(std::string_view word, uint32_t row, std::vector<uint32_t> &fresh) {
+        Postings &p = postings[intern(word, fresh)];
+        if (p.rows > 0 && p.next == row + 1) return; // word repeated in this row
+        uint32_t gap = row - p.next;
+        while (gap >= 0x80) {
+            p.gaps.push_back(static_cast<uint8_t>(gap | 0x80));
+            gap >>= 7;
+            encodedBytes++;
+        }
+        p.gaps.push_back(static_cast<uint8_t>(gap));
+        encodedBytes++;
+        p.next = row + 1;
+        p.rows++;
+    }
+
+    static void decode(const Postings &p, std::vector<uint32_t> &out) {
+        out.reserve(out.size() + p.rows);
+        uint32_t row = 0;
+        const uint8_t *b = p.gaps.data(), *end = b + p.gaps.size();
+        while (b < end) {
+            uint32_t gap = 0;
+            int shift = 0;
+            while (*b & 0x80) {
+                gap |= static_cast<uint32_t>(*b++ & 0x7f) << shift;
+                shift += 7;
+            }
+            gap |= static_cast<uint32_t>(*b++) << shift;
+            row += gap;
+            out.push_back(row++);
+        }
+    }
+
+    // First eight bytes, big-endian, so integer order is text order
+    static uint64_t sortKey(std::string_view w) {
+        uint64_t key = 0;
+        for (size_t k = 0; k < 8; k++)
+            key = (key << 8) | (k < w.size() ? static_cast<unsigned char>(w[k]) : 0u);
+        return key;
+    }
+
+    // Vocabulary positions [first, second) of the words starting with prefix
+    std::pair<size_t, size_t> prefixRange(std::string_view prefix) const {
+        auto lo = std::lower_bound(vocabulary.begin(), vocabulary.end(), prefix,
+                                   [this](uint32_t w, std::string_view p) { return words[w] < p; });
+        auto hi = lo;
+        while (hi != vocabulary.end() && words[*hi].compare(0, prefix.size(), prefix) == 0) ++hi;
+        return {static_cast<size_t>(lo - vocabulary.begin()), static_cast<size_t>(hi - vocabulary.begin())};
+    }
+
+    // Upper bound on the rows of a term, without decoding
+    size_t estimate(const TextTerm &t) const {
+        if (!t.prefix) {
+            uint32_t w = find(t.word);
+            return w == kEmpty ? 0 : postings[w].rows;
+        }
+        size_t n = 0;
+        std::pair<size_t, size_t> r = prefixRange(t.word);
+        for (size_t k = r.first; k < r.second; k++) n += postings[vocabulary[k]].rows;
+        return n;
+    }
+
+    // Ascending rows of one term
+    std::vector<uint32_t> rowsOf(const TextTerm &t) const {
+        std::vector<uint32_t> rows;
+        if (!t.prefix) {
+            uint32_t w = find(t.word);
+            if (w != kEmpty) decode(postings[w], rows);
+            return rows;
+        }
+        std::pair<size_t, size_t> r = prefixRange(t.word);
+        for (size_t k = r.first; k < r.second; k++) decode(postings[vocabulary[k]], rows);
+        if (r.second - r.first > 1) {
+            std::sort(rows.begin(), rows.end());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        }
+        return rows;
+    }
+
+public:
+    void clear() {
+        text.clear();
+        words.clear();
+        postings.clear();
+        slots.clear();
+        vocabulary.clear();
+        encodedBytes = 0;
+    }
+
+    size_t wordCount() const { return words.size(); }
+    size_t bytes() const { return encodedBytes; }
+
+    // Rebuild from every row of table
+    void build(const ExpenseTable &table) {
+        clear();
+        addRange(table, 0, table.size());
+    }
+
+    // Index rows [first, last), which must follow every row indexed so far
+    void addRange(const ExpenseTable &table, size_t first, size_t last) {
+        std::vector<uint32_t> fresh;
+        for (size_t i = first; i < last; i++) {
+            forEachWord(table.description(i), [&](std::string_view w) {
+                addWord(w, static_cast<uint32_t>(i), fresh);
+            });
+        }
+        if (fresh.empty()) return;
+        // New words join the sorted vocabulary in one merge. They are sorted
+        // on their first eight bytes as an integer, touching the text only
+        // to break ties.
+        std::vector<std::pair<uint64_t, uint32_t>> keyed;
+        keyed.reserve(fresh.size());
+        for (uint32_t w : fresh) keyed.emplace_back(sortKey(words[w]), w);
+        std::sort(keyed.begin(), keyed.end(), [this](const auto &a, const auto &b) {
+            return a.first != b.first ? a.first < b.first : words[a.second] < words[b.second];
+        });
+        size_t mid = vocabulary.size();
+        for (const auto &k : keyed) vocabulary.push_back(k.second);
+        std::inplace_merge(vocabulary.begin(), vocabulary.begin() + mid, vocabulary.end(),
+                           [this](uint32_t a, uint32_t b) { return words[a] < words[b]; });
+    }
+
+    // Ascending rows whose description has all (or, with any, at least one) of terms
+    std::vector<uint32_t> lookup(const std::vector<TextTerm> &terms, bool any = false) const {
+        std::vector<uint32_t> result;
+        if (terms.empty()) return result;
+        if (any) {
+            for (const TextTerm &t : terms) {
+                std::vector<uint32_t> rows = rowsOf(t), merged;
+                merged.reserve(result.size() + rows.size());
+                std::set_union(result.begin(), result.end(), rows.begin(), rows.end(),
+                               std::back_inserter(merged));
+                result.swap(merged);
+            }
+            return result;
+        }
+
+        // Intersect from the rarest term so the candidate list only shrinks
+        std::vector<size_t> order(terms.size());
+        std::vector<size_t> sizes(terms.size());
+        for (size_t k = 0; k < terms.size(); k++) {
+            order[k] = k;
+            sizes[k] = estimate(terms[k]);
+        }
+        std::sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] < sizes[b]; });
+        if (sizes[order[0]] == 0) return result;
+        result = rowsOf(terms[order[0]]);
+        for (size_t k = 1; k < order.size() && !result.empty(); k++) {
+            std::vector<uint32_t> rows = rowsOf(terms[order[k]]), kept;
+            std::set_intersection(result.begin(), result.end(), rows.begin(), rows.end(),
+                                  std::back_inserter(kept));
+            result.swap(kept);
+        }
+        return result;
+    }
+
+    // Same test for one description, for rows without an index
+    static bool matches(std::string_view description, const std::vector<TextTerm> &terms, bool any = false) {
+        std::vector<char> found(terms.size(), 0);
+        forEachWord(description, [&](std::string_view w) {
+            for (size_t k = 0; k < terms.size(); k++) {
+                const TextTerm &t = terms[k];
+                if (t.prefix ? w.compare(0, t.word.size(), t.word) == 0 : w == t.word) found[k] = 1;
+            }
+        });
+        size_t hits = static_cast<size_t>(std::count(found.begin(), found.end(), 1));
+        return any ? hits > 0 : hits == terms.size();
+    }
+};
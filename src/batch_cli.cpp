@@ -0,0 +1,512 @@
+// cpp/src/batch_cli.cpp
+#include "../include/expense.h"
+#include "../include/csv_stream_query.h"
+#include "../include/expense_writer.h"
+#include "../include/segment_manifest.h"
+#include "../include/columnar_segment.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+
+// Defined in expense_service.cpp
+int runServer(const std::string &path, const StoreOptions &options, uint16_t port, unsigned threads);
+
+// Non-interactive command mode:
+//
+//   expense_tracker_v2 [--file PATH] [--snapshot] [--segments MONTHS] [--columnar]
+//                      [--format table|csv|json] [--compact] COMMAND [ARGS...]
+//
+// With --segments (or when PATH already holds a manifest) PATH is a
+// directory of CSV segments, one per period of MONTHS months. --columnar
+// stores sealed segments compressed when they are next written (or on
+// --compact).
+//
+// Commands:
+//   add --date D --amount A --category C [--description T] [--id ID]
+//   update ID [--date D] [--amount A] [--category C] [--description T]
+//   delete ID [ID...]
+//   import PATH|-               append every row of a CSV file (or stdin)
+//   list
+//   query [FILTERS] [--sort date|amount|category|id] [--desc] [--limit N] [--offset N]
+//   summarize [FILTERS]
+//   export PATH
+//   batch PATH|-                run one command per line from a file (or stdin)
+//   scan [--from D] [--to D] [--category C...] [--min A] [--max A] [--summary]
+//                               stream the file (or the segments overlapping
+//                               --from/--to) through the filters without loading it
+//   serve [--port N] [--threads N]
+//                               keep the store resident behind a loopback HTTP/JSON API
+//
+// FILTERS: --from D --to D --category C (repeatable) --min A --max A --text T
+//          --search "WORD PREFIX* ..." [--any]   whole words (all, or any with --any)
+// Every command of a run goes through one store: adds are appended to the
+// journal with a single fsync at the end, so a batch costs one commit. The
+// journal is folded into the CSV at the end of a run on --compact, or once
+// it reaches a quarter of the ledger's size (at least 4096 records).
+
+class BatchRunner {
+private:
+    ExpenseStore *store;    // null for commands that stream the file instead
+    std::string path;
+    ExpenseWriter writer;   // buffered; flushed when the runner is done
+    DateValidator dates;    // "today" as of the start of the run
+
+    // Value of --name in args, or fallback
+    static std::string option(const std::vector<std::string> &args, const std::string &name,
+                              const std::string &fallback = "") {
+        for (size_t i = 1; i + 1 < args.size(); i++) {
+            if (args[i] == name) return args[i + 1];
+        }
+        return fallback;
+    }
+
+    void printHeader() {
+        writer.header();
+    }
+
+    void printRows(const QueryResult &rows) {
+        writer.header();
+        writer.rows(store->columns(), rows);
+    }
+
+    void printStats(const std::vector<CategoryStats> &stats) {
+        writer.statsHeader();
+        for (const CategoryStats &s : stats) writer.stats(s);
+    }
+
+    bool checkDate(const std::string &date) {
+        if (date.empty() || dates.accepts(date)) return true;
+        std::cerr << "Error: invalid date '" << date << "' (expected YYYY-MM-DD, not in the future)\n";
+        return false;
+    }
+
+    // Parse a non-empty --min/--max amount into m, complaining if invalid
+    bool checkAmount(const std::string &amount, Money &m) {
+        if (Money::parse(amount, m)) return true;
+        std::cerr << "Error: invalid amount '" << amount << "'\n";
+        return false;
+    }
+
+    int cmdAdd(const std::vector<std::string> &args) {
+        Expense e;
+        e.id = option(args, "--id");
+        if (e.id.empty()) e.id = store->nextId();
+        e.date = option(args, "--date");
+        e.category = option(args, "--category");
+        e.description = option(args, "--description");
+        std::string amount = option(args, "--amount");
+        if (e.date.empty() || amount.empty() || e.category.empty()) {
+            std::cerr << "Error: add needs --date, --amount and --category\n";
+            return 1;
+        }
+        if (!checkDate(e.date)) return 2;
+        if (!Money::parse(amount, e.amount) || e.amount < 0) {
+            std::cerr << "Error: invalid amount '" << amount << "'\n";
+            return 2;
+        }
+        return store->addExpense(e) ? 0 : 2;
+    }
+
+    // Change the given fields of an existing expense
+    int cmdUpdate(const std::vector<std::string> &args) {
+        Expense e;
+        if (args.size() < 2 || args[1].compare(0, 2, "--") == 0) {
+            std::cerr << "Error: update needs an expense id\n";
+            return 1;
+        }
+        if (!store->findById(args[1], e)) {
+            std::cerr << "Error: no expense with id " << args[1] << ".\n";
+            return 2;
+        }
+        std::string date = option(args, "--date", e.date);
+        if (date != e.date && !checkDate(date)) return 2;
+        e.date = date;
+        e.category = option(args, "--category", e.category);
+        e.description = option(args, "--description", e.description);
+        std::string amount = option(args, "--amount");
+        if (!amount.empty() && (!Money::parse(amount, e.amount) || e.amount < 0)) {
+            std::cerr << "Error: invalid amount '" << amount << "'\n";
+            return 2;
+        }
+        return store->updateExpense(e) ? 0 : 2;
+    }
+
+    int cmdDelete(const std::vector<std::string> &args) {
+        if (args.size() < 2) {
+            std::cerr << "Error: delete needs an expense id\n";
+            return 1;
+        }
+        std::vector<std::string> ids(args.begin() + 1, args.end());
+        return store->deleteExpenses(ids) == ids.size() ? 0 : 2;
+    }
+
+    int cmdImport(const std::vector<std::string> &args) {
+        if (args.size() < 2) {
+            std::cerr << "Error: import needs a CSV path or -\n";
+            return 1;
+        }
+        size_t rows = args[1] == "-" ? store->importCsv(std::cin) : store->importCsv(args[1]);
+        std::cerr << "Imported " << rows << " expense(s).\n";
+        return 0;
+    }
+
+    // Build a store query from the filter options shared by query and summarize
+    bool parseQuery(const std::vector<std::string> &args, ExpenseQuery &q) {
+        std::string from = option(args, "--from");
+        std::string to = option(args, "--to");
+        if (!checkDate(from) || !checkDate(to)) return false;
+        q.between(from, to);
+        for (size_t i = 1; i + 1 < args.size(); i++) {
+            if (args[i] == "--category") q.inCategory(args[i + 1]);
+        }
+        std::string minAmount = option(args, "--min"), maxAmount = option(args, "--max");
+        Money m;
+        if (!minAmount.empty()) {
+            if (!checkAmount(minAmount, m)) return false;
+            q.amountAtLeast(m);
+        }
+        if (!maxAmount.empty()) {
+            if (!checkAmount(maxAmount, m)) return false;
+            q.amountAtMost(m);
+        }
+        q.contains(option(args, "--text"));
+        q.search(option(args, "--search"), std::find(args.begin(), args.end(), "--any") != args.end());
+
+        std::string sort = option(args, "--sort");
+        bool desc = std::find(args.begin(), args.end(), "--desc") != args.end();
+        if (sort == "date") q.sortBy(ExpenseQuery::SortKey::Date, desc);
+        else if (sort == "amount") q.sortBy(ExpenseQuery::SortKey::Amount, desc);
+        else if (sort == "category") q.sortBy(ExpenseQuery::SortKey::Category, desc);
+        else if (sort == "id") q.sortBy(ExpenseQuery::SortKey::Id, desc);
+        else if (!sort.empty()) {
+            std::cerr << "Error: unknown sort key '" << sort << "' (date, amount, category, id)\n";
+            return false;
+        }
+        std::string limit = option(args, "--limit"), offset = option(args, "--offset");
+        if (!limit.empty()) q.limit(std::strtoull(limit.c_str(), nullptr, 10));
+        if (!offset.empty()) q.offset(std::strtoull(offset.c_str(), nullptr, 10));
+        return true;
+    }
+
+    int cmdList() {
+        printRows(store->find(ExpenseQuery()));
+        return 0;
+    }
+
+    int cmdQuery(const std::vector<std::string> &args) {
+        ExpenseQuery q;
+        if (!parseQuery(args, q)) return 2;
+        printRows(store->find(q));
+        return 0;
+    }
+
+    int cmdSummarize(const std::vector<std::string> &args) {
+        ExpenseQuery q;
+        if (!parseQuery(args, q)) return 2;
+        printStats(store->summarize(q));
+        return 0;
+    }
+
+    // Stream the rows of a columnar segment through query, skipping the
+    // blocks its date and amount bounds rule out
+    template <typename Fn>
+    static bool scanColumnar(const CsvStreamQuery &query, const std::string &file, Fn &&fn) {
+        ColumnarSegment::Filter filter;
+        filter.from = query.from;
+        filter.to = query.to;
+        if (query.hasMin) filter.minAmount = query.minAmount.raw();
+        if (query.hasMax) filter.maxAmount = query.maxAmount.raw();
+        CsvStreamQuery::Match m;
+        return ColumnarSegment::scan(file, filter, [&](const ExpenseTable &block) {
+            for (size_t i = 0; i < block.size(); i++) {
+                if (query.matchFields(block.id(i), block.day(i), block.amount(i),
+                                      block.categoryName(block.categoryCode(i)), block.description(i), m))
+                    fn(static_cast<const CsvStreamQuery::Match &>(m));
+            }
+        });
+    }
+
+    // Query the CSV file (and its journal) in a streaming pass, bounded memory.
+    // Of a segmented ledger only the segments overlapping the date range are read.
+    int cmdScan(const std::vector<std::string> &args) {
+        CsvStreamQuery query;
+        std::string from = option(args, "--from");
+        std::string to = option(args, "--to");
+        if (!checkDate(from) || !checkDate(to)) return 2;
+        if (!from.empty()) query.from = parseDate(from);
+        if (!to.empty()) query.to = parseDate(to);
+        for (size_t i = 1; i + 1 < args.size(); i++) {
+            if (args[i] == "--category") query.categories.push_back(args[i + 1]);
+        }
+        std::string minAmount = option(args, "--min"), maxAmount = option(args, "--max");
+        query.hasMin = !minAmount.empty();
+        query.hasMax = !maxAmount.empty();
+        if ((query.hasMin && !checkAmount(minAmount, query.minAmount)) ||
+            (query.hasMax && !checkAmount(maxAmount, query.maxAmount))) return 2;
+        bool summary = std::find(args.begin(), args.end(), "--summary") != args.end();
+
+        CsvStreamQuery::Summary totals;
+        auto onMatch = [&](const CsvStreamQuery::Match &m) {
+            if (summary) {
+                CsvStreamQuery::addTo(totals, m);
+                return;
+            }
+            writer.row(m.row.id, m.row.date, m.amount, m.row.category, m.row.description);
+        };
+
+        // Files to stream: the CSV, or the segments that can hold the date range
+        std::vector<std::string> files;
+        SegmentManifest manifest(path, 0);
+        bool segmented = manifest.read();
+        if (!segmented) {
+            files.push_back(path);
+        } else if (query.from == INT32_MIN && query.to == INT32_MAX) {
+            for (const SegmentInfo &s : manifest.all()) files.push_back(manifest.pathOf(s));
+        } else {
+            // Undated rows never match a date range, so their segment is skipped too
+            for (const SegmentInfo *s : manifest.overlapping(query.from, query.to))
+                files.push_back(manifest.pathOf(*s));
+        }
+
+        // Ids the journal updates or deletes, with the record that decides
+        // each one; only the journal is held in memory, never the file
+        ExpenseJournal journal(path);
+        if (segmented) journal.setBasePath(manifest.path());
+        std::map<std::string, size_t> lastChange;
+        size_t record = 0;
+        bool rewritten = false;
+        journal.replay([&](char op, const std::string &row) {
+            if (op == 'U' || op == 'D') rewritten = true;
+            if (rewritten) lastChange[std::string(op == 'D' ? std::string_view(row) : splitCsvRow(row).id)] = record;
+            record++;
+        });
+        auto current = [&](std::string_view id, size_t at) {
+            auto it = lastChange.find(std::string(id));
+            return it == lastChange.end() || it->second == at;
+        };
+
+        if (!summary) printHeader();
+        bool found = segmented;
+        auto onBaseMatch = [&](const CsvStreamQuery::Match &m) {
+            if (lastChange.empty() || current(m.row.id, SIZE_MAX)) onMatch(m);
+        };
+        for (const std::string &file : files) {
+            bool read = SegmentManifest::isColumnar(file) ? scanColumnar(query, file, onBaseMatch)
+                                                          : query.scan(file, onBaseMatch);
+            if (!read && segmented) std::cerr << "Warning: segment " << file << " could not be read.\n";
+            found = read || found;
+        }
+        CsvStreamQuery::Match m;
+        record = 0;
+        found = journal.replay([&](char op, const std::string &row) {
+            if (op != 'D' && query.matchLine(row, m) && (lastChange.empty() || current(m.row.id, record)))
+                onMatch(m);
+            record++;
+        }) > 0 || found;
+        if (!found) {
+            std::cerr << "Error: could not read " << path << "\n";
+            return 2;
+        }
+
+        if (summary) {
+            std::vector<CategoryStats> stats;
+            for (uint32_t code : totals.categories.sortedCodes())
+                stats.push_back(toCategoryStats(totals.categories.name(code), totals.stats[code]));
+            printStats(stats);
+        }
+        return 0;
+    }
+
+    int cmdBatch(const std::vector<std::string> &args) {
+        if (args.size() < 2) {
+            std::cerr << "Error: batch needs a command file or -\n";
+            return 1;
+        }
+        std::ifstream file;
+        if (args[1] != "-") {
+            file.open(args[1]);
+            if (!file.is_open()) {
+                std::cerr << "Error: could not open " << args[1] << "\n";
+                return 2;
+            }
+        }
+        std::istream &in = args[1] == "-" ? std::cin : file;
+
+        std::string line;
+        size_t lineNo = 0;
+        int status = 0;
+        while (std::getline(in, line)) {
+            lineNo++;
+            std::vector<std::string> cmd = tokenize(line);
+            if (cmd.empty() || cmd[0][0] == '#') continue;
+            if (cmd[0] == "batch") {
+                std::cerr << "Error: line " << lineNo << ": nested batch is not allowed\n";
+                status = 1;
+                continue;
+            }
+            int rc = run(cmd);
+            if (rc != 0) {
+                std::cerr << "  (batch line " << lineNo << ")\n";
+                status = rc;
+            }
+        }
+        return status;
+    }
+
+public:
+    BatchRunner(ExpenseStore *s, const std::string &file, OutputFormat f,
+                std::ostream &o = std::cout)
+        : store(s), path(file), writer(o, f) {}
+
+    // Split a command line on blanks; "double quotes" group words
+    static std::vector<std::string> tokenize(const std::string &line) {
+        std::vector<std::string> tokens;
+        std::string cur;
+        bool quoted = false, inToken = false;
+        for (char c : line) {
+            if (c == '"') {
+                quoted = !quoted;
+                inToken = true;
+            } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+                if (inToken) tokens.push_back(cur);
+                cur.clear();
+                inToken = false;
+            } else {
+                cur += c;
+                inToken = true;
+            }
+        }
+        if (inToken) tokens.push_back(cur);
+        return tokens;
+    }
+
+    // Run one command; returns a process exit status
+    int run(const std::vector<std::string> &args) {
+        const std::string &cmd = args[0];
+        if (cmd == "scan") return cmdScan(args);
+        if (!store) {
+            std::cerr << "Error: '" << cmd << "' cannot be combined with streaming commands\n";
+            return 1;
+        }
+        if (cmd == "add") return cmdAdd(args);
+        if (cmd == "update") return cmdUpdate(args);
+        if (cmd == "delete") return cmdDelete(args);
+        if (cmd == "import") return cmdImport(args);
+        if (cmd == "list") return cmdList();
+        if (cmd == "query") return cmdQuery(args);
+        if (cmd == "summarize") return cmdSummarize(args);
+        if (cmd == "batch") return cmdBatch(args);
+        if (cmd == "export") {
+            if (args.size() < 2) {
+                std::cerr << "Error: export needs a path\n";
+                return 1;
+            }
+            return store->exportCsv(args[1]) ? 0 : 2;
+        }
+        std::cerr << "Error: unknown command '" << cmd << "'\n";
+        return 1;
+    }
+};
+
+void printBatchUsage() {
+    std::cerr << "Usage: expense_tracker_v2 [--file PATH] [--snapshot] [--segments MONTHS] [--columnar]\n"
+              << "                          [--format table|csv|json] [--compact] COMMAND [ARGS...]\n"
+              << "Commands:\n"
+              << "  add --date D --amount A --category C [--description T] [--id ID]\n"
+              << "  update ID [--date D] [--amount A] [--category C] [--description T]\n"
+              << "  delete ID [ID...]\n"
+              << "  import PATH|-\n"
+              << "  list\n"
+              << "  query [FILTERS] [--sort date|amount|category|id] [--desc] [--limit N] [--offset N]\n"
+              << "  summarize [FILTERS]\n"
+              << "  export PATH\n"
+              << "  batch PATH|-\n"
+              << "  scan [--from D] [--to D] [--category C...] [--min A] [--max A] [--summary]\n"
+              << "  serve [--port N] [--threads N]\n"
+              << "FILTERS: --from D --to D --category C (repeatable) --min A --max A --text T\n"
+              << "         --search \"WORD PREFIX* ...\" [--any]\n"
+              << "Run without arguments for the interactive menu.\n";
+}
+
+// Fewest journal records a run compacts at without --compact
+static constexpr size_t kBatchJournalRecords = 4096;
+
+// Entry point for command mode; defaultPath is the CSV the menu would use
+int runBatch(int argc, char **argv, const std::string &defaultPath) {
+    std::string path = defaultPath;
+    StoreOptions options;
+    OutputFormat format = OutputFormat::Table;
+    bool compact = false;
+
+    int i = 1;
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--file" && i + 1 < argc) {
+            path = argv[++i];
+        } else if (arg == "--snapshot") {
+            options.snapshot = true;
+        } else if (arg == "--segments" && i + 1 < argc) {
+            options.segmentMonths = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--columnar") {
+            options.columnar = true;
+        } else if (arg == "--compact") {
+            compact = true;
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string f = argv[++i];
+            if (f == "table") format = OutputFormat::Table;
+            else if (f == "csv") format = OutputFormat::Csv;
+            else if (f == "json") format = OutputFormat::Json;
+            else {
+                std::cerr << "Error: unknown format '" << f << "'\n";
+                return 1;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            printBatchUsage();
+            return 0;
+        } else {
+            break;
+        }
+    }
+    if (i >= argc) {
+        printBatchUsage();
+        return 1;
+    }
+
+    std::vector<std::string> command(argv + i, argv + argc);
+    if (command[0] == "scan") {
+        // Streams the file; the store is never loaded
+        BatchRunner runner(nullptr, path, format);
+        return runner.run(command);
+    }
+
+    if (command[0] == "serve") {
+        unsigned long port = 8080, threads = 0;
+        for (size_t k = 1; k + 1 < command.size(); k++) {
+            if (command[k] == "--port") port = std::strtoul(command[k + 1].c_str(), nullptr, 10);
+            if (command[k] == "--threads") threads = std::strtoul(command[k + 1].c_str(), nullptr, 10);
+        }
+        return runServer(path, options, static_cast<uint16_t>(port), static_cast<unsigned>(threads));
+    }
+
+    ExpenseStore store(path, options);
+    // Group every add of this run into one journal commit
+    store.enableJournal(SIZE_MAX);
+
+    BatchRunner runner(&store, path, format);
+    int status = runner.run(command);
+
+    store.sync();
+    // Fold the journal back in once it holds a quarter as many records as
+    // the ledger has rows, so repeated runs cannot grow it without bound
+    // while each rewrite still covers many runs
+    size_t journalLimit = std::max(kBatchJournalRecords, store.size() / 4);
+    if (compact || store.journalRecords() >= journalLimit) store.compact();
+    std::cout.flush();
+    return status;
+}
@@ -0,0 +1,336 @@
+// cpp/src/concurrent_store.cpp
+#include "../include/expense.h"
+#include "../include/expense_table.h"
+#include "../include/date_index.h"
+#include "../include/expense_query.h"
+#include "../include/text_index.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ExpenseStore for many concurrent readers and one or more writers.
+//
+// Readers work on immutable versions: a version is a list of sealed
+// segments (each a small ExpenseTable with its own date and text indexes)
+// plus a tail of recent rows held in small copy-on-write chunks.
+//
+// Each reader thread has a slot per store holding the version it last
+// used, together with a reference count of its own. snapshot() reads the
+// published epoch (one atomic load) and, if it is unchanged, hands out the
+// slot's version: no lock is taken and no cache line is shared with other
+// readers, so read throughput grows with the number of reader threads
+// (measured by the concurrentRead benchmark). Only the first read after a
+// publish takes a short mutex to pick up the new version. The store owns
+// the slots too: destroying it frees the versions they hold, and slots of
+// threads that have exited are dropped when another thread attaches. A
+// live thread that stops reading keeps its version until it reads again.
+//
+// Writers are serialized on a mutex. Each write persists through an
+// ExpenseStore (journal, snapshot and compaction behave as usual), copies
+// the last tail chunk (at most kChunkRows rows) with the new rows
+// appended, seals the tail into an indexed segment once it reaches
+// kTailRows, and publishes the result as the next version. Versions that
+// are no longer current are freed when their last reader drops them.
+class ConcurrentExpenseStore {
+public:
+    static constexpr size_t kSegmentRows = 1u << 16; // rows per segment built at load
+    static constexpr size_t kTailRows = 4096;        // tail size before it is sealed
+    static constexpr size_t kChunkRows = 64;         // rows per copy-on-write tail chunk
+    static_assert(kTailRows % kChunkRows == 0, "the tail seals on a chunk boundary");
+
+    struct Segment {
+        ExpenseTable table;
+        DateIndex index;
+        TextIndex words;
+    };
+
+    struct Version {
+        std::vector<std::shared_ptr<const Segment>> segments;
+        std::vector<std::shared_ptr<const Segment>> tail; // unindexed chunks of the newest rows
+        size_t tailRows = 0;                   // below kTailRows
+        size_t rows = 0;
+        uint64_t epoch = 0;                    // bumped by every publish
+    };
+
+    // A consistent, immutable view of the store
+    class Snapshot {
+    private:
+        std::shared_ptr<const Version> v;
+
+    public:
+        explicit Snapshot(std::shared_ptr<const Version> version) : v(std::move(version)) {}
+
+        size_t size() const { return v->rows; }
+        uint64_t epoch() const { return v->epoch; }
+
+        // Matching expenses, sorted and paged as the query asks
+        std::vector<Expense> find(const ExpenseQuery &query) const {
+            // Predicates run per segment into one result table, then the
+            // result is sorted and paged as a whole
+            ExpenseQuery filter = query;
+            filter.sortKey = ExpenseQuery::SortKey::None;
+            filter.skip = 0;
+            filter.count = SIZE_MAX;
+            size_t wanted = query.sortKey == ExpenseQuery::SortKey::None ? query.pageEnd() : SIZE_MAX;
+
+            ExpenseTable matches;
+            forEachSegment([&](const Segment &s, bool indexed) {
+                if (matches.size() >= wanted) return;
+                filter.count = wanted == SIZE_MAX ? SIZE_MAX : wanted - matches.size();
+                for (uint32_t i : filter.select(s.table, indexed ? &s.index : nullptr,
+                                                indexed ? &s.words : nullptr))
+                    matches.appendRow(s.table, i);
+            });
+
+            ExpenseQuery order;
+            order.sortBy(query.sortKey, query.descending).offset(query.skip).limit(query.count);
+            std::vector<Expense> result;
+            std::vector<uint32_t> rows = order.select(matches);
+            result.reserve(rows.size());
+            for (uint32_t i : rows) result.push_back(matches.materialize(i));
+            return result;
+        }
+
+        // Stats per category over the matching rows, sorted by category
+        std::vector<CategoryStats> summarize(const ExpenseQuery &query) const {
+            std::map<std::string, KernelStats> byName;
+            forEachSegment([&](const Segment &s, bool indexed) {
+                std::vector<KernelStats> stats = query.aggregate(s.table, indexed ? &s.index : nullptr,
+                                                                 indexed ? &s.words : nullptr);
+                for (size_t c = 0; c < stats.size(); c++) {
+                    if (stats[c].count == 0) continue;
+                    byName[s.table.categoryName(static_cast<uint32_t>(c))].merge(stats[c]);
+                }
+            });
+            std::vector<CategoryStats> result;
+            for (const auto &entry : byName) result.push_back(toCategoryStats(entry.first, entry.second));
+            return result;
+        }
+
+        // Expenses dated start..end (inclusive, YYYY-MM-DD), in insertion order
+        std::vector<Expense> queryByDate(const std::string &start, const std::string &end) const {
+            if (parseDate(start) == kNoDate || parseDate(end) == kNoDate) return std::vector<Expense>();
+            return find(ExpenseQuery().between(start, end));
+        }
+
+        std::vector<CategoryStats> statsByCategory() const {
+            return summarize(ExpenseQuery());
+        }
+
+    private:
+        template <typename Fn>
+        void forEachSegment(Fn &&fn) const {
+            for (const auto &s : v->segments) fn(*s, true);
+            for (const auto &chunk : v->tail) fn(*chunk, false);
+        }
+    };
+
+private:
+    ExpenseStore store;                       // persistence; touched only under writeLock
+    std::mutex writeLock;
+    const uint64_t instance;                  // keys this store in the reader threads' slots
+    mutable std::mutex publishLock;           // guards current and readers
+    std::shared_ptr<const Version> current;
+    std::atomic<uint64_t> published{0};       // epoch of current
+
+    // The version one reader thread used last; copies of it count
+    // references on a control block private to the thread. Only that
+    // thread touches epoch and version while the store is alive.
+    struct ReaderSlot {
+        uint64_t epoch = 0;
+        std::shared_ptr<const Version> version;
+        std::atomic<bool> closed{false};      // the store is gone
+    };
+    using ReaderSlots = std::unordered_map<uint64_t, std::shared_ptr<ReaderSlot>>;
+    mutable std::vector<std::shared_ptr<ReaderSlot>> readers;
+
+    // A new slot for the calling thread, registered with this store
+    std::shared_ptr<ReaderSlot> attachReader(ReaderSlots &slots) const {
+        for (auto it = slots.begin(); it != slots.end();) {
+            if (it->second && it->second->closed.load(std::memory_order_acquire)) it = slots.erase(it);
+            else ++it;
+        }
+        auto slot = std::make_shared<ReaderSlot>();
+        std::lock_guard<std::mutex> lock(publishLock);
+        // A slot only the store still holds belongs to a thread that exited
+        readers.erase(std::remove_if(readers.begin(), readers.end(),
+                                     [](const std::shared_ptr<ReaderSlot> &r) { return r.use_count() == 1; }),
+                      readers.end());
+        readers.push_back(slot);
+        return slot;
+    }
+
+    static uint64_t nextInstance() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    static std::shared_ptr<const Segment> chunkOf(ExpenseTable &&table) {
+        auto s = std::make_shared<Segment>();
+        s->table = std::move(table);
+        return s;
+    }
+
+    void publish(std::shared_ptr<const Version> v) {
+        uint64_t epoch = v->epoch;
+        std::lock_guard<std::mutex> lock(publishLock);
+        current = std::move(v);
+        published.store(epoch, std::memory_order_release);
+    }
+
+    static std::shared_ptr<const Segment> seal(ExpenseTable &&table) {
+        auto s = std::make_shared<Segment>();
+        s->table = std::move(table);
+        s->index.build(s->table.dayData(), s->table.size());
+        s->words.build(s->table);
+        return s;
+    }
+
+    // Publish a version holding every row of store (initial load)
+    void publishAll() {
+        auto v = std::make_shared<Version>();
+        const ExpenseTable &all = store.columns();
+        for (size_t first = 0; first < all.size(); first += kSegmentRows) {
+            ExpenseTable part;
+            part.appendRange(all, first, std::min(all.size(), first + kSegmentRows));
+            v->segments.push_back(seal(std::move(part)));
+        }
+        v->rows = all.size();
+        publish(std::move(v));
+    }
+
+    // Publish a version with store's rows [first, size()) appended
+    void publishFrom(size_t first) {
+        const ExpenseTable &all = store.columns();
+        size_t last = all.size();
+        if (first >= last) return;
+
+        // Only writers replace current, and they hold writeLock
+        const Version &old = *current;
+        auto v = std::make_shared<Version>();
+        v->segments = old.segments;
+        v->tail = old.tail;
+        v->tailRows = old.tailRows;
+        v->rows = old.rows + (last - first);
+        v->epoch = old.epoch + 1;
+
+        // Copy only the last chunk if it has room, append, and seal the
+        // whole tail into one segment every time it fills up
+        ExpenseTable chunk;
+        if (!v->tail.empty() && v->tail.back()->table.size() < kChunkRows) {
+            chunk = v->tail.back()->table;
+            v->tail.pop_back();
+        }
+        while (first < last) {
+            size_t take = std::min(last - first, kChunkRows - chunk.size());
+            chunk.appendRange(all, first, first + take);
+            first += take;
+            v->tailRows += take;
+            if (chunk.size() < kChunkRows) break;
+            v->tail.push_back(chunkOf(std::move(chunk)));
+            chunk = ExpenseTable();
+            if (v->tailRows == kTailRows) {
+                ExpenseTable merged;
+                merged.reserve(kTailRows);
+                for (const auto &c : v->tail) merged.appendTable(c->table);
+                v->segments.push_back(seal(std::move(merged)));
+                v->tail.clear();
+                v->tailRows = 0;
+            }
+        }
+        if (!chunk.empty()) v->tail.push_back(chunkOf(std::move(chunk)));
+        publish(std::move(v));
+    }
+
+public:
+    ConcurrentExpenseStore(const std::string &path, const StoreOptions &options = StoreOptions())
+        : store(path, options), instance(nextInstance()) {
+        store.enableJournal();
+        publishAll();
+    }
+
+    // Versions cached by reader threads are freed here, not when the
+    // threads next read or exit
+    ~ConcurrentExpenseStore() {
+        std::lock_guard<std::mutex> lock(publishLock);
+        for (const auto &slot : readers) {
+            slot->version.reset();
+            slot->closed.store(true, std::memory_order_release);
+        }
+    }
+
+    ConcurrentExpenseStore(const ConcurrentExpenseStore &) = delete;
+    ConcurrentExpenseStore &operator=(const ConcurrentExpenseStore &) = delete;
+
+    // The current version; lock-free unless a new version was published
+    // since this thread's last read, and never waits for a write in progress
+    Snapshot snapshot() const {
+        thread_local ReaderSlots slots;
+        std::shared_ptr<ReaderSlot> &slot = slots[instance];
+        if (!slot) slot = attachReader(slots);
+        uint64_t epoch = published.load(std::memory_order_acquire);
+        if (!slot->version || slot->epoch != epoch) {
+            std::shared_ptr<const Version> shared;
+            {
+                std::lock_guard<std::mutex> lock(publishLock);
+                shared = current;
+            }
+            // Alias it through a control block only this thread's copies touch
+            auto holder = std::make_shared<std::shared_ptr<const Version>>(std::move(shared));
+            slot->epoch = (*holder)->epoch;
+            slot->version = std::shared_ptr<const Version>(holder, holder->get());
+        }
+        return Snapshot(slot->version);
+    }
+
+    size_t size() const {
+        return snapshot().size();
+    }
+
+    // A fresh id; does not wait for writers
+    std::string nextId() {
+        return store.nextId();
+    }
+
+    // Copy of the expense with this id, from the writer's id index
+    bool findById(const std::string &id, Expense &out) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        return store.findById(id, out);
+    }
+
+    // False if the id is already taken
+    bool addExpense(const Expense &e) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        size_t first = store.columns().size();
+        if (!store.addExpense(e)) return false;
+        publishFrom(first);
+        return true;
+    }
+
+    // Persisted with one journal sync, published as one version
+    size_t addExpenses(std::vector<Expense> &&batch) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        size_t first = store.columns().size();
+        size_t added = store.addExpenses(std::move(batch));
+        publishFrom(first);
+        return added;
+    }
+
+    size_t importCsv(const std::string &path) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        size_t first = store.columns().size();
+        size_t added = store.importCsv(path);
+        publishFrom(first);
+        return added;
+    }
+
+    // Fold the journal into the base file; readers are not affected
+    void compact() {
+        std::lock_guard<std::mutex> lock(writeLock);
+        store.compact();
+    }
+};
@@ -0,0 +1,399 @@
+// cpp/src/expense_service.cpp
+#include "../include/expense.h"
+#include "../include/expense_query.h"
+#include "../include/expense_writer.h"
+#include "../include/http_server.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// HTTP/JSON front end for a resident ConcurrentExpenseStore:
+//
+//   POST /expenses        {"date":..,"amount":..,"category":..,"description":..,"id":..}
+//   POST /expenses/bulk   [ {...}, {...} ]          (one journal sync for the batch)
+//   GET  /expenses        ?from&to&category(repeatable)&min&max&text&search&any&sort&desc&limit&offset
+//   GET  /summary         same filters, per-category stats
+//   GET  /metrics         request counts and latency percentiles per endpoint
+//   GET  /health
+//
+// Queries run on the worker threads against lock-free store snapshots.
+class ExpenseService {
+public:
+    // Latency samples of one endpoint (a ring of the most recent requests)
+    struct Metric {
+        static constexpr size_t kSamples = 4096;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        std::vector<double> micros;     // ring buffer
+        size_t next = 0;
+
+        void record(double us, bool error) {
+            requests++;
+            if (error) errors++;
+            if (micros.size() < kSamples) micros.push_back(us);
+            else micros[next] = us;
+            next = (next + 1) % kSamples;
+        }
+    };
+
+private:
+    ConcurrentExpenseStore &store;
+    std::mutex metricsLock;
+    std::map<std::string, Metric> metrics;
+
+    // ---- minimal JSON input: flat objects with string/number/bool/null values ----
+
+    static void skipSpace(const std::string &s, size_t &p) {
+        while (p < s.size() && (s[p] == ' ' || s[p] == '\t' || s[p] == '\n' || s[p] == '\r')) p++;
+    }
+
+    static bool parseString(const std::string &s, size_t &p, std::string &out) {
+        if (p >= s.size() || s[p] != '"') return false;
+        out.clear();
+        for (p++; p < s.size(); p++) {
+            char c = s[p];
+            if (c == '"') {
+                p++;
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (++p >= s.size()) return false;
+            switch (s[p]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (p + 4 >= s.size()) return false;
+                unsigned code = static_cast<unsigned>(std::strtoul(s.substr(p + 1, 4).c_str(), nullptr, 16));
+                p += 4;
+                // UTF-8 encode (surrogate pairs are kept as individual code units)
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += s[p]; break; // \" \\ \/
+            }
+        }
+        return false;
+    }
+
+    // Object at p into fields; numbers keep their source text so amounts stay exact
+    static bool parseObject(const std::string &s, size_t &p, std::map<std::string, std::string> &fields) {
+        skipSpace(s, p);
+        if (p >= s.size() || s[p] != '{') return false;
+        p++;
+        skipSpace(s, p);
+        if (p < s.size() && s[p] == '}') {
+            p++;
+            return true;
+        }
+        while (p < s.size()) {
+            std::string key, value;
+            skipSpace(s, p);
+            if (!parseString(s, p, key)) return false;
+            skipSpace(s, p);
+            if (p >= s.size() || s[p] != ':') return false;
+            p++;
+            skipSpace(s, p);
+            if (p < s.size() && s[p] == '"') {
+                if (!parseString(s, p, value)) return false;
+            } else {
+                size_t start = p;
+                while (p < s.size() && s[p] != ',' && s[p] != '}' && s[p] != ' ' && s[p] != '\n' &&
+                       s[p] != '\r' && s[p] != '\t') p++;
+                value = s.substr(start, p - start);
+                if (value.empty()) return false;
+                if (value == "null") value.clear();
+            }
+            fields[key] = value;
+            skipSpace(s, p);
+            if (p < s.size() && s[p] == ',') {
+                p++;
+                continue;
+            }
+            if (p < s.size() && s[p] == '}') {
+                p++;
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    static std::string quote(const std::string &s) {
+        return HttpServer::jsonString(s);
+    }
+
+    // Metrics key of a request method; anything unknown shares one bucket
+    static std::string methodName(const std::string &method) {
+        static const char *const kKnown[] = {"GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS"};
+        for (const char *known : kKnown)
+            if (method == known) return method;
+        return "OTHER";
+    }
+
+    static HttpResponse error(int status, const std::string &message) {
+        HttpResponse r;
+        r.status = status;
+        r.body = "{\"error\":" + quote(message) + "}\n";
+        return r;
+    }
+
+    // Validate one JSON object as a new expense; returns an error message or ""
+    std::string toExpense(const std::map<std::string, std::string> &fields, const DateValidator &dates,
+                          Expense &e) {
+        auto get = [&fields](const char *name) {
+            auto it = fields.find(name);
+            return it == fields.end() ? std::string() : it->second;
+        };
+        e.id = get("id");
+        if (e.id.empty()) e.id = store.nextId();
+        e.date = get("date");
+        e.category = get("category");
+        e.description = get("description");
+        std::string amount = get("amount");
+        if (e.date.empty() || amount.empty() || e.category.empty())
+            return "date, amount and category are required";
+        if (!dates.accepts(e.date)) return "invalid date '" + e.date + "'";
+        if (!Money::parse(amount, e.amount) || e.amount < 0) return "invalid amount '" + amount + "'";
+        return std::string();
+    }
+
+    // Filters from the query string, as accepted by the batch query command
+    static std::string toQuery(const HttpRequest &req, ExpenseQuery &q) {
+        std::string from = req.param("from"), to = req.param("to");
+        DateValidator dates;
+        if ((!from.empty() && !dates.accepts(from)) || (!to.empty() && !dates.accepts(to)))
+            return "invalid date";
+        q.between(from, to);
+        auto cats = req.query.equal_range("category");
+        for (auto it = cats.first; it != cats.second; ++it) q.inCategory(it->second);
+        Money m;
+        std::string minAmount = req.param("min"), maxAmount = req.param("max");
+        if (!minAmount.empty()) {
+            if (!Money::parse(minAmount, m)) return "invalid min";
+            q.amountAtLeast(m);
+        }
+        if (!maxAmount.empty()) {
+            if (!Money::parse(maxAmount, m)) return "invalid max";
+            q.amountAtMost(m);
+        }
+        q.contains(req.param("text"));
+        q.search(req.param("search"), req.param("any") == "1" || req.param("any") == "true");
+        std::string sort = req.param("sort");
+        bool desc = req.param("desc") == "1" || req.param("desc") == "true";
+        if (sort == "date") q.sortBy(ExpenseQuery::SortKey::Date, desc);
+        else if (sort == "amount") q.sortBy(ExpenseQuery::SortKey::Amount, desc);
+        else if (sort == "category") q.sortBy(ExpenseQuery::SortKey::Category, desc);
+        else if (sort == "id") q.sortBy(ExpenseQuery::SortKey::Id, desc);
+        else if (!sort.empty()) return "unknown sort key";
+        std::string limit = req.param("limit"), offset = req.param("offset");
+        if (!limit.empty()) q.limit(std::strtoull(limit.c_str(), nullptr, 10));
+        if (!offset.empty()) q.offset(std::strtoull(offset.c_str(), nullptr, 10));
+        return std::string();
+    }
+
+    // JSON-lines output of the writer as one JSON array
+    static std::string toArray(const std::string &lines) {
+        std::string body = "[";
+        body.reserve(lines.size() + 3);
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (lines[i] != '\n') body += lines[i];
+            else if (i + 1 < lines.size()) body += ',';
+        }
+        body += "]\n";
+        return body;
+    }
+
+    HttpResponse addOne(const HttpRequest &req) {
+        std::map<std::string, std::string> fields;
+        size_t p = 0;
+        if (!parseObject(req.body, p, fields)) return error(400, "body must be a JSON object");
+        Expense e;
+        std::string problem = toExpense(fields, DateValidator(), e);
+        if (!problem.empty()) return error(400, problem);
+        if (!store.addExpense(e)) return error(409, "id " + e.id + " already exists");
+        HttpResponse r;
+        r.status = 201;
+        r.body = "{\"id\":" + quote(e.id) + "}\n";
+        return r;
+    }
+
+    HttpResponse addBulk(const HttpRequest &req) {
+        const std::string &s = req.body;
+        size_t p = 0;
+        skipSpace(s, p);
+        if (p >= s.size() || s[p] != '[') return error(400, "body must be a JSON array");
+        p++;
+        std::vector<Expense> batch;
+        DateValidator dates;
+        skipSpace(s, p);
+        while (p < s.size() && s[p] != ']') {
+            std::map<std::string, std::string> fields;
+            if (!parseObject(s, p, fields)) return error(400, "malformed expense object");
+            Expense e;
+            std::string problem = toExpense(fields, dates, e);
+            if (!problem.empty())
+                return error(400, "expense " + std::to_string(batch.size()) + ": " + problem);
+            batch.push_back(std::move(e));
+            skipSpace(s, p);
+            if (p < s.size() && s[p] == ',') {
+                p++;
+                skipSpace(s, p);
+                if (p < s.size() && s[p] == ']') return error(400, "expected an expense after ','");
+            } else if (p < s.size() && s[p] != ']') {
+                return error(400, "expected ',' between expenses");
+            }
+        }
+        if (p >= s.size()) return error(400, "unterminated array");
+        size_t added = store.addExpenses(std::move(batch));
+        HttpResponse r;
+        r.status = 201;
+        r.body = "{\"added\":" + std::to_string(added) + "}\n";
+        return r;
+    }
+
+    HttpResponse list(const HttpRequest &req) {
+        ExpenseQuery q;
+        std::string problem = toQuery(req, q);
+        if (!problem.empty()) return error(400, problem);
+        std::ostringstream lines;
+        {
+            ExpenseWriter writer(lines, OutputFormat::Json);
+            for (const Expense &e : store.snapshot().find(q)) writer.row(e);
+        }
+        HttpResponse r;
+        r.body = toArray(lines.str());
+        return r;
+    }
+
+    HttpResponse summary(const HttpRequest &req) {
+        ExpenseQuery q;
+        std::string problem = toQuery(req, q);
+        if (!problem.empty()) return error(400, problem);
+        std::ostringstream lines;
+        {
+            ExpenseWriter writer(lines, OutputFormat::Json);
+            for (const CategoryStats &s : store.snapshot().summarize(q)) writer.stats(s);
+        }
+        HttpResponse r;
+        r.body = toArray(lines.str());
+        return r;
+    }
+
+    HttpResponse metricsReport() {
+        std::lock_guard<std::mutex> lock(metricsLock);
+        std::string body = "{";
+        bool first = true;
+        for (const auto &entry : metrics) {
+            std::vector<double> sorted = entry.second.micros;
+            std::sort(sorted.begin(), sorted.end());
+            auto pct = [&sorted](double p) {
+                if (sorted.empty()) return 0.0;
+                return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+            };
+            if (!first) body += ',';
+            body += quote(entry.first);
+            char buf[256];
+            std::snprintf(buf, sizeof(buf),
+                          ":{\"requests\":%llu,\"errors\":%llu,\"p50_us\":%.1f,"
+                          "\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+                          static_cast<unsigned long long>(entry.second.requests),
+                          static_cast<unsigned long long>(entry.second.errors),
+                          pct(0.50), pct(0.90), pct(0.99), sorted.empty() ? 0.0 : sorted.back());
+            body += buf;
+            first = false;
+        }
+        body += "}\n";
+        HttpResponse r;
+        r.body = body;
+        return r;
+    }
+
+    HttpResponse route(const HttpRequest &req, std::string &endpoint) {
+        endpoint = methodName(req.method) + " " + req.path;
+        bool get = req.method == "GET", post = req.method == "POST";
+        if (req.path == "/expenses") {
+            if (post) return addOne(req);
+            if (get) return list(req);
+        } else if (req.path == "/expenses/bulk") {
+            if (post) return addBulk(req);
+        } else if (req.path == "/summary") {
+            if (get) return summary(req);
+        } else if (req.path == "/metrics") {
+            if (get) return metricsReport();
+        } else if (req.path == "/health") {
+            if (get) {
+                HttpResponse r;
+                r.body = "{\"status\":\"ok\",\"expenses\":" + std::to_string(store.size()) + "}\n";
+                return r;
+            }
+        } else {
+            endpoint = "other";
+            return error(404, "not found");
+        }
+        return error(405, "method not allowed");
+    }
+
+public:
+    explicit ExpenseService(ConcurrentExpenseStore &s) : store(s) {}
+
+    // Handle one request and record its latency under "METHOD /path"
+    HttpResponse handle(const HttpRequest &req) {
+        auto start = std::chrono::steady_clock::now();
+        std::string endpoint;
+        HttpResponse r = route(req, endpoint);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(metricsLock);
+        metrics[endpoint].record(us, r.status >= 400);
+        return r;
+    }
+};
+
+namespace {
+HttpServer *activeServer = nullptr;
+
+extern "C" void stopServer(int) {
+    if (activeServer) activeServer->requestStop();
+}
+}
+
+// Serve the store at path on 127.0.0.1:port until interrupted
+int runServer(const std::string &path, const StoreOptions &options, uint16_t port, unsigned threads) {
+    ConcurrentExpenseStore store(path, options);
+    ExpenseService service(store);
+    HttpServer server([&service](const HttpRequest &req) { return service.handle(req); });
+    if (!server.listen(port)) {
+        std::cerr << "Error: could not listen on 127.0.0.1:" << port << "\n";
+        return 2;
+    }
+    std::cerr << "Serving " << store.size() << " expense(s) on http://127.0.0.1:" << server.port()
+              << "/ (Ctrl+C to stop)\n";
+
+    activeServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.run(threads);
+    activeServer = nullptr;
+
+    store.compact();
+    return 0;
+}
@@ -1,138 +1,869 @@
 // cpp/src/expense_store.cpp
 #include "../include/expense.h"
+#include "../include/expense_journal.h"
+#include "../include/mapped_file.h"
+#include "../include/csv_scanner.h"
+#include "../include/expense_table.h"
+#include "../include/date_index.h"
+#include "../include/rollup_cache.h"
+#include "../include/aggregate_kernels.h"
+#include "../include/expense_snapshot.h"
+#include "../include/expense_query.h"
+#include "../include/expense_writer.h"
+#include "../include/id_index.h"
+#include "../include/text_index.h"
+#include "../include/segment_manifest.h"
+#include "../include/columnar_segment.h"
 #include <vector>
 #include <fstream>
-#include <sstream>
 #include <map>
 #include <iomanip>
 #include <algorithm>
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <unordered_set>
+
+// Settings applied before the initial load()
+struct StoreOptions {
+    bool snapshot = false;     // keep a binary snapshot (<csv>.snap) and start from it
+    bool csv = true;           // with snapshot: false stores only the snapshot
+    unsigned loadThreads = 0;  // 0 = pick from hardware concurrency
+    unsigned segmentMonths = 0; // > 0: the path is a directory of segments this many months long
+    bool columnar = false;     // with segments: store sealed ones compressed (ColumnarSegment)
+};
 
 class ExpenseStore {
 private:
-    std::vector<Expense> expenses;
+    ExpenseTable table;
+    DateIndex dateIndex;            // rows ordered by date for range queries
+    RollupCache rollups;            // per day/month category totals
+    IdIndex idIndex;                // id -> row
+    mutable TextIndex textIndex;    // description word -> rows, built by the first word search
+    mutable bool textIndexed = false;
+    IdGenerator ids;                // next free "E<n>" id
     std::string filepath;
+    ExpenseJournal journal;
+    bool journalMode = false;
+    size_t compactionThreshold = 0; // journal records before auto-compaction (0 = never)
+    double deadRatio = 0.25;        // dead share of rows that triggers compaction
+    size_t minDeadRows = kMinDeadRows;
+    unsigned loadThreads = 0;       // 0 = pick from hardware concurrency
+    bool useSnapshot = false;       // load from / save to <csv>.snap
+    bool writeCsv = true;           // save() also rewrites the CSV
+    bool segmented = false;         // filepath is a directory of per-period segments
+    unsigned segmentMonths = 0;     // period length asked for (0 = the manifest's)
+    bool columnarCold = false;      // write sealed segments in the column encoding
+    SegmentManifest segments;
+    std::set<int32_t> stalePeriods; // segments whose file no longer matches the table
+
+    // Smallest slice of a file worth handing to its own thread in auto mode
+    static constexpr size_t kMinParallelChunk = 4u << 20;
+
+    // Index rows [first, last) by id; returns how many reuse an existing id
+    size_t indexIds(size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) ids.observe(table.id(i));
+        return idIndex.addRange(table, first, last);
+    }
+
+    // Rebuild every index from the table; returns how many rows reuse an id
+    size_t rebuildIndexes() {
+        dateIndex.build(table.dayData(), table.size());
+        rollups.build(table.dayData(), table.categoryData(), table.amountData(), table.size());
+        textIndex.clear();
+        textIndexed = false;
+        idIndex.clear();
+        return indexIds(0, table.size());
+    }
+
+    // Mark the segment holding day for rewriting at the next save
+    void touch(int32_t day) {
+        if (segmented) stalePeriods.insert(segments.periodOf(day));
+    }
+
+    // Tombstone row; it drops out of every index and query
+    void retire(uint32_t row) {
+        touch(table.day(row));
+        idIndex.erase(table, table.id(row));
+        rollups.remove(table.day(row), table.categoryCode(row), table.amountData()[row]);
+        table.kill(row);
+    }
+
+    // Fold the journal into the base once it has grown too long or too
+    // much of the table is dead; both cost O(1) amortized per mutation
+    void maybeCompact() {
+        bool longJournal = compactionThreshold > 0 && journal.recordCount() >= compactionThreshold;
+        bool manyDead = table.deadCount() >= minDeadRows &&
+                        static_cast<double>(table.deadCount()) > deadRatio * static_cast<double>(table.size());
+        if (longJournal || manyDead) compact();
+    }
+
+    // Apply one journal record during load. Updates and deletes find their
+    // row through the id index, which is built on the first one.
+    void replayRecord(char op, const std::string &record, bool &indexed) {
+        if (op == 'A') {
+            table.append(splitCsvRow(record));
+            touch(table.day(table.size() - 1));
+            if (indexed) idIndex.insert(table, static_cast<uint32_t>(table.size() - 1));
+            return;
+        }
+        if (op != 'U' && op != 'D') return;
+        if (!indexed) {
+            idIndex.clear();
+            idIndex.addRange(table, 0, table.size());
+            indexed = true;
+        }
+        CsvRow row;
+        if (op == 'U') row = splitCsvRow(record);
+        uint32_t old = idIndex.find(table, op == 'U' ? row.id : std::string_view(record));
+        if (old != IdIndex::kNotFound) {
+            idIndex.erase(table, table.id(old));
+            touch(table.day(old));
+            table.kill(old);
+        }
+        if (op == 'U') {
+            table.append(row);
+            touch(table.day(table.size() - 1));
+            idIndex.insert(table, static_cast<uint32_t>(table.size() - 1));
+        }
+    }
+
+    // Index and persist rows [first, size()) that were just appended; op
+    // tags their journal records
+    void commitAppended(size_t first, char op = 'A') {
+        size_t last = table.size();
+        if (first >= last) return;
+        size_t duplicates = indexIds(first, last);
+        if (duplicates > 0) {
+            std::cerr << "Warning: " << duplicates
+                      << " added expense(s) reuse an existing id; lookups return the first.\n";
+        }
+        if (last - first == 1) dateIndex.add(table.day(first), static_cast<uint32_t>(first));
+        else dateIndex.addRange(table.dayData(), first, last);
+        for (size_t i = first; i < last; i++)
+            rollups.add(table.day(i), table.categoryCode(i), table.amount(i).raw());
+        if (textIndexed) textIndex.addRange(table, first, last);
+
+        if (!journalMode) {
+            if (segmented) appendToSegments(first, last);
+            save();
+            return;
+        }
+        for (size_t i = first; i < last; i++) touch(table.day(i));
+        std::string row;
+        bool batch = last - first > 1;
+        for (size_t i = first; i < last; i++) {
+            row.clear();
+            table.formatCsvRow(i, row);
+            journal.append(op, row, batch);
+        }
+        if (batch) journal.sync();
+        maybeCompact();
+    }
+
+    // Print the rows of a query result as a table
+    void displayRows(const QueryResult &rows) const {
+        ExpenseWriter writer(std::cout);
+        writer.rows(table, rows);
+    }
+
+    // The text index for a query that searches words (else null). Building
+    // it is deferred to the first such query so loads that never search
+    // do not pay for it; appends keep it current from then on.
+    const TextIndex *wordIndex(const ExpenseQuery &query) const {
+        if (query.terms.empty()) return nullptr;
+        if (!textIndexed) {
+            textIndex.build(table);
+            textIndexed = true;
+        }
+        return &textIndex;
+    }
+
+    std::string snapshotPath() const {
+        return filepath + ".snap";
+    }
+
+    // File whose size, mtime and hash stamp the snapshot (the manifest of a segmented ledger)
+    std::string baseFile() const {
+        return segmented ? segments.path() : filepath;
+    }
+
+    // The snapshot is stamped with the CSV it mirrors (none in snapshot-only mode)
+    bool writeSnapshot() const {
+        return ExpenseSnapshot::write(table, snapshotPath(), writeCsv ? baseFile() : std::string());
+    }
+
+    // Store the ledger as a directory of segment files. The journal and
+    // snapshot sit next to the directory and are stamped with its manifest.
+    void useSegments(unsigned months) {
+        segmented = true;
+        writeCsv = true;
+        segmentMonths = months;
+        segments = SegmentManifest(filepath, months);
+        journal.setBasePath(segments.path());
+    }
+
+    // Read the manifest and, unless rows is false, every segment it lists.
+    // Returns false if there is no manifest yet.
+    bool loadSegments(bool rows) {
+        if (!segments.read()) return false;
+        if (segmentMonths != 0 && segmentMonths != segments.monthsPerSegment()) {
+            std::cerr << "Warning: " << filepath << " is partitioned by " << segments.monthsPerSegment()
+                      << " month(s); keeping that instead of " << segmentMonths << ".\n";
+        }
+        if (!rows) return true;
+        // Sized once from the manifest, not grown segment by segment
+        size_t total = table.size();
+        for (const SegmentInfo &s : segments.all()) total += s.rows;
+        table.reserve(total);
+        for (const SegmentInfo &s : segments.all()) {
+            std::string path = segments.pathOf(s);
+            if (SegmentManifest::isColumnar(s.file)) {
+                if (!ColumnarSegment::read(table, path))
+                    std::cerr << "Warning: segment " << path << " could not be read.\n";
+                continue;
+            }
+            MappedFile file(path);
+            if (!file.isOpen()) {
+                std::cerr << "Warning: segment " << path << " is missing.\n";
+                continue;
+            }
+            loadMapped(file.view());
+        }
+        return true;
+    }
+
+    // Append rows [first, last) to the files of their open segments. Rows
+    // of a sealed or already stale period mark it for rewriting instead.
+    void appendToSegments(size_t first, size_t last) {
+        int32_t today = localToday();
+        std::map<int32_t, std::string> lines;   // period -> CSV text to append
+        for (size_t i = first; i < last; i++) {
+            int32_t day = table.day(i);
+            int32_t period = segments.periodOf(day);
+            SegmentInfo *s = segments.find(period);
+            if (segments.sealed(period, today) || stalePeriods.count(period) ||
+                (s && SegmentManifest::isColumnar(s->file))) {
+                stalePeriods.insert(period);
+                continue;
+            }
+            std::string &out = lines[period];
+            table.formatCsvRow(i, out);
+            out += '\n';
+            SegmentInfo &info = segments.get(period);
+            if (info.rows == 0 || day < info.minDay) info.minDay = day;
+            if (info.rows == 0 || day > info.maxDay) info.maxDay = day;
+            info.rows++;
+        }
+        for (auto &entry : lines) {
+            std::string path = segments.pathOf(segments.get(entry.first));
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0) entry.second.insert(0, "id,date,amount,category,description\n");
+            std::FILE *out = std::fopen(path.c_str(), "ab");
+            bool ok = out && std::fwrite(entry.second.data(), 1, entry.second.size(), out) == entry.second.size();
+            ok = out && std::fclose(out) == 0 && ok;
+            // The rewrite at save() recounts the segment from the table
+            if (!ok) stalePeriods.insert(entry.first);
+        }
+    }
+
+    // Rewrite each stale segment as a new file (the next generation), then
+    // switch the manifest over and remove the files it replaced. With
+    // columnarCold, sealed segments still in CSV are compressed as well.
+    bool saveSegments() {
+        if (!SegmentManifest::makeDirectory(filepath)) {
+            std::cerr << "Error: Could not create directory " << filepath << std::endl;
+            return false;
+        }
+        int32_t today = localToday();
+        if (columnarCold) {
+            for (const SegmentInfo &s : segments.all()) {
+                if (segments.sealed(s.period, today) && !SegmentManifest::isColumnar(s.file))
+                    stalePeriods.insert(s.period);
+            }
+        }
+        std::vector<std::string> replaced;
+        for (int32_t period : stalePeriods) {
+            std::vector<uint32_t> rows = dateIndex.range(period, segments.periodEnd(period));
+            std::sort(rows.begin(), rows.end()); // file order
+            rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                      [this](uint32_t r) { return !table.isLive(r); }), rows.end());
+            SegmentInfo *old = segments.find(period);
+            if (rows.empty()) {
+                if (old) replaced.push_back(old->file);
+                segments.erase(period);
+                continue;
+            }
+            SegmentInfo next = old ? *old : SegmentInfo();
+            next.period = period;
+            if (old) next.generation++;
+            bool cold = columnarCold && segments.sealed(period, today);
+            next.file = SegmentManifest::fileName(period, next.generation, cold);
+            next.rows = rows.size();
+            next.minDay = next.maxDay = table.day(rows[0]);
+            for (uint32_t r : rows) {
+                next.minDay = std::min(next.minDay, table.day(r));
+                next.maxDay = std::max(next.maxDay, table.day(r));
+            }
+            bool written = cold ? ColumnarSegment::write(table, rows, segments.pathOf(next))
+                                : writeCsvFile(segments.pathOf(next), [&rows](auto &&emit) {
+                                      for (uint32_t r : rows) emit(r);
+                                  });
+            if (!written) return false;
+            if (old) replaced.push_back(old->file);
+            segments.get(period) = next;
+        }
+        if (!segments.write()) return false;
+        for (const std::string &file : replaced)
+            std::remove((filepath + "/" + file).c_str());
+        stalePeriods.clear();
+        return true;
+    }
+
+    // Write the header and the rows passed to emit by forEachRow(emit) as
+    // CSV to path (via a temp file and rename)
+    template <typename Fn>
+    bool writeCsvFile(const std::string &path, Fn &&forEachRow) const {
+        // Write to a temp file and rename so a crash never leaves a half-written base
+        std::string tmpPath = path + ".tmp";
+        std::ofstream file(tmpPath);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not save to file " << path << std::endl;
+            return false;
+        }
+
+        // Rows are formatted into one buffer and written in large blocks
+        std::string buf = "id,date,amount,category,description\n";
+        forEachRow([this, &buf, &file](size_t i) {
+            table.formatCsvRow(i, buf);
+            buf += '\n';
+            if (buf.size() >= (1u << 20)) {
+                file.write(buf.data(), buf.size());
+                buf.clear();
+            }
+        });
+        file.write(buf.data(), buf.size());
+        file.close();
+
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename() does not replace files on Windows
+#endif
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Error: Could not save to file " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
 
 public:
-    ExpenseStore(const std::string &path) : filepath(path) {
+    ExpenseStore(const std::string &path) : filepath(path), journal(path) {
+        if (SegmentManifest::exists(path)) useSegments(0);
+        load();
+    }
+
+    ExpenseStore(const std::string &path, const StoreOptions &options)
+        : filepath(path), journal(path), loadThreads(options.loadThreads),
+          useSnapshot(options.snapshot), writeCsv(options.csv || !options.snapshot) {
+        if (options.segmentMonths > 0 || SegmentManifest::exists(path)) {
+            useSegments(options.segmentMonths);
+            columnarCold = options.columnar;
+        }
+        // Without a CSV the snapshot is the base file the journal applies to
+        else if (!writeCsv) journal.setBasePath(snapshotPath());
         load();
     }
 
-    // Load expenses from CSV file
+    // Load expenses (from the snapshot if it is current, otherwise the CSV
+    // file or segments), then replay the journal on top of them
     void load() {
-        expenses.clear();
-        std::ifstream file(filepath);
-        if (!file.is_open()) {
-            std::cerr << "No existing data file found. Starting fresh.\n";
-            return;
+        table.clear();
+        stalePeriods.clear();
+        bool fromSnapshot = useSnapshot && ExpenseSnapshot::read(table, snapshotPath(),
+                                                                 writeCsv ? baseFile() : std::string());
+        bool importedCsv = false;
+        if (segmented) {
+            bool found = loadSegments(!fromSnapshot);
+            importedCsv = found && !fromSnapshot;
+            if (!found) {
+                // Start the directory right away so later runs find the ledger
+                // (and the journal is stamped with its manifest)
+                std::cerr << "No existing data file found. Starting fresh.\n";
+                if (!SegmentManifest::makeDirectory(filepath) || !segments.write())
+                    std::cerr << "Error: Could not create segment directory " << filepath << std::endl;
+            }
+            if (importedCsv && useSnapshot) writeSnapshot();
+        } else if (!fromSnapshot) {
+            MappedFile file(filepath);
+            if (!file.isOpen()) {
+                if (!journal.exists())
+                    std::cerr << "No existing data file found. Starting fresh.\n";
+            } else {
+                loadMapped(file.view());
+                importedCsv = true;
+                // Parse the CSV once; later starts map the snapshot instead
+                if (useSnapshot && writeCsv) writeSnapshot();
+            }
         }
 
-        std::string line;
-        std::getline(file, line); // skip header
-
-        while (std::getline(file, line)) {
-            if (line.empty()) continue; // Skip empty lines
-            
-            std::stringstream ss(line);
-            Expense e;
-            std::string amountStr;
-            
-            // Parse CSV fields properly
-            std::getline(ss, e.id, ',');
-            std::getline(ss, e.date, ',');
-            std::getline(ss, amountStr, ',');
-            std::getline(ss, e.category, ',');
-            std::getline(ss, e.description); // Get rest of line for description (may contain commas)
-            
-            // Convert amount string to double
-            try {
-                e.amount = std::stod(amountStr);
-            } catch (const std::exception&) {
-                e.amount = 0.0; // Default to 0 if conversion fails
+        bool indexed = false;
+        journal.replay([this, &indexed](char op, const std::string &record) {
+            replayRecord(op, record, indexed);
+        });
+        // Rows replaced or deleted in the journal are dropped in memory;
+        // the files keep them until the next compaction
+        table.removeDead();
+
+        // Snapshot-only stores take the CSV over once, journal included
+        if (importedCsv && useSnapshot && !writeCsv) save();
+
+        size_t duplicates = rebuildIndexes();
+
+        if (table.badDateCount() > 0) {
+            std::cerr << "Warning: " << table.badDateCount()
+                      << " expense(s) have an unrecognized date.\n";
+        }
+        if (duplicates > 0) {
+            std::cerr << "Warning: " << duplicates
+                      << " expense(s) reuse an earlier id; lookups return the first.\n";
+        }
+    }
+
+    // Append a parsed row to t unless validator (if any) rejects its date;
+    // the date is parsed once either way
+    static bool appendRow(ExpenseTable &t, const CsvRow &row, const DateValidator *validator) {
+        if (!validator) {
+            t.append(row);
+            return true;
+        }
+        int32_t day = parseDate(row.date);
+        if (!validator->accepts(day)) return false;
+        t.append(row.id, day, parseCsvAmount(row.amount), row.category, row.description);
+        return true;
+    }
+
+    static void warnRejected(size_t rows) {
+        if (rows == 0) return;
+        std::cerr << "Warning: skipped " << rows << " row(s) with an invalid date"
+                  << " (expected YYYY-MM-DD, 1900-2100, not in the future).\n";
+    }
+
+    // Parse a mapped CSV file, in parallel chunks when it is large enough.
+    // With a validator, rows whose date it rejects are skipped and counted.
+    size_t loadMapped(std::string_view data, const DateValidator *validator = nullptr) {
+        size_t threads = loadThreads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min(threads, data.size() / kMinParallelChunk + 1);
+        }
+
+        size_t rejected = 0;
+        if (threads <= 1) {
+            // Scan the mapping in place; the header and empty lines are skipped
+            forEachCsvLine(data, [this, validator, &rejected](std::string_view line) {
+                if (!appendRow(table, splitCsvRow(line), validator)) rejected++;
+            });
+            return rejected;
+        }
+
+        // Newline-aligned byte ranges, each parsed on its own thread
+        std::vector<std::string_view> chunks = splitCsvChunks(data, threads);
+        std::vector<ExpenseTable> parts(chunks.size());
+        std::vector<size_t> partRejected(chunks.size(), 0);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            workers.emplace_back([&chunks, &parts, &partRejected, validator, i]() {
+                forEachCsvLine(chunks[i], [&parts, &partRejected, validator, i](std::string_view line) {
+                    if (!appendRow(parts[i], splitCsvRow(line), validator)) partRejected[i]++;
+                }, false);
+            });
+        }
+        for (auto &w : workers) w.join();
+        for (size_t n : partRejected) rejected += n;
+
+        // Merge in chunk order to preserve file order; text arenas are moved, not copied
+        size_t rows = table.size();
+        for (const auto &part : parts) rows += part.size();
+        table.reserve(rows);
+        for (auto &part : parts) table.appendTable(std::move(part));
+        return rejected;
+    }
+
+    // Write all expenses as CSV to path (via a temp file and rename)
+    bool exportCsv(const std::string &path) const {
+        return writeCsvFile(path, [this](auto &&emit) {
+            for (size_t i = 0; i < table.size(); i++) {
+                if (table.isLive(i)) emit(i);
             }
-            
-            expenses.push_back(e);
+        });
+    }
+
+    // Save expenses to the CSV file (or the stale segments) and/or snapshot;
+    // dead rows are dropped
+    void save() {
+        if (table.deadCount() > 0) {
+            table.removeDead();
+            rebuildIndexes();
         }
-        file.close();
+        journal.close();
+        // The base now contains every journaled record
+        if (saveBase()) journal.reset();
     }
 
-    // Save expenses to CSV file
-    void save() const {
-        std::ofstream file(filepath);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not save to file " << filepath << std::endl;
-            return;
+private:
+    // Rewrite the base file(s) from the in-memory table
+    bool saveBase() {
+        if (!writeCsv) return writeSnapshot();
+        if (segmented ? !saveSegments() : !exportCsv(filepath)) return false;
+        // Written after the CSV so it carries the new CSV's stamp; if it
+        // fails the stamp no longer matches and the CSV is used instead
+        if (useSnapshot) writeSnapshot();
+        return true;
+    }
+
+public:
+
+    // Append each add to the journal instead of rewriting the whole file.
+    // syncEvery groups that many appends into one fsync.
+    void enableJournal(size_t syncEvery = 1, size_t autoCompactAfter = 0) {
+        journalMode = true;
+        journal.setSyncInterval(syncEvery);
+        compactionThreshold = autoCompactAfter;
+    }
+
+    // Fewest dead rows worth a compaction, so small ledgers are not rewritten per delete
+    static constexpr size_t kMinDeadRows = 1024;
+
+    // Compact once more than ratio of the rows are dead (and at least
+    // minDead of them), so deletes and updates never rewrite the file each
+    void setCompactionRatio(double ratio, size_t minDead = kMinDeadRows) {
+        deadRatio = ratio;
+        minDeadRows = minDead;
+    }
+
+    // Number of threads load() parses with (0 = automatic, 1 = serial)
+    void setLoadThreads(unsigned n) {
+        loadThreads = n;
+    }
+
+    // Fold the journal back into the base CSV file (and compress sealed
+    // segments, if the store is set to)
+    void compact() {
+        if (journal.exists() || columnarCold) save();
+    }
+
+    // Flush journaled records that are waiting for a group commit
+    void sync() {
+        journal.sync();
+    }
+
+    size_t journalRecords() const {
+        return journal.recordCount();
+    }
+
+    bool isSegmented() const {
+        return segmented;
+    }
+
+    // Segment files of a segmented ledger (empty otherwise)
+    const SegmentManifest &segmentManifest() const {
+        return segments;
+    }
+
+    // A fresh id, distinct from every id loaded or added so far
+    std::string nextId() {
+        return ids.generate();
+    }
+
+    // Copy of the expense with this id; false if there is none
+    bool findById(const std::string &id, Expense &out) const {
+        uint32_t row = idIndex.find(table, id);
+        if (row == IdIndex::kNotFound) return false;
+        out = table.materialize(row);
+        return true;
+    }
+
+    bool containsId(const std::string &id) const {
+        return idIndex.find(table, id) != IdIndex::kNotFound;
+    }
+
+    // Add new expense; rejected if its id is already taken
+    bool addExpense(const Expense &e) {
+        if (containsId(e.id)) {
+            std::cerr << "Error: an expense with id " << e.id << " already exists.\n";
+            return false;
         }
-        
-        file << "id,date,amount,category,description\n";
-        for (const auto &e : expenses) {
-            file << e.id << "," << e.date << ","
-                 << std::fixed << std::setprecision(2) << e.amount << ","
-                 << e.category << "," << e.description << "\n";
+        table.append(e);
+        commitAppended(table.size() - 1);
+        return true;
+    }
+
+    // Replace the expense with e.id. The old row is tombstoned and the new
+    // one appended, so the expense moves to the end of file order.
+    bool updateExpense(const Expense &e) {
+        uint32_t row = idIndex.find(table, e.id);
+        if (row == IdIndex::kNotFound) {
+            std::cerr << "Error: no expense with id " << e.id << ".\n";
+            return false;
         }
-        file.close();
+        retire(row);
+        table.append(e);
+        commitAppended(table.size() - 1, 'U');
+        return true;
+    }
+
+    // Remove the expense with this id. Without the journal every call
+    // rewrites the base file; use deleteExpenses() or enableJournal() to
+    // remove many expenses.
+    bool deleteExpense(const std::string &id) {
+        uint32_t row = idIndex.find(table, id);
+        if (row == IdIndex::kNotFound) {
+            std::cerr << "Error: no expense with id " << id << ".\n";
+            return false;
+        }
+        retire(row);
+        if (!journalMode) {
+            save();
+            return true;
+        }
+        journal.append('D', id);
+        maybeCompact();
+        return true;
+    }
+
+    // Remove the expenses with these ids; persisted with one rewrite (or
+    // one journal sync). Returns how many were found.
+    size_t deleteExpenses(const std::vector<std::string> &ids) {
+        size_t removed = 0;
+        for (const std::string &id : ids) {
+            uint32_t row = idIndex.find(table, id);
+            if (row == IdIndex::kNotFound) {
+                std::cerr << "Error: no expense with id " << id << ".\n";
+                continue;
+            }
+            retire(row);
+            if (journalMode) journal.append('D', id, true);
+            removed++;
+        }
+        if (removed == 0) return 0;
+        if (!journalMode) {
+            save();
+            return removed;
+        }
+        journal.sync();
+        maybeCompact();
+        return removed;
+    }
+
+    // Add many expenses at once: storage is sized up front, indexes are
+    // updated once and the batch is persisted with a single write.
+    // Expenses whose id is already taken are skipped.
+    size_t addExpenses(std::vector<Expense> &&batch) {
+        std::vector<Expense> owned(std::move(batch)); // released when the batch is stored
+        return addExpenses(owned.begin(), owned.end());
+    }
+
+    // Same for any forward range of Expense
+    template <typename It>
+    size_t addExpenses(It first, It last) {
+        size_t start = table.size();
+        size_t textBytes = 0, count = 0;
+        for (It it = first; it != last; ++it, ++count)
+            textBytes += it->id.size() + it->description.size();
+        table.reserve(start + count, table.textBytes() + textBytes);
+
+        std::unordered_set<std::string_view> batchIds;
+        size_t skipped = 0;
+        for (; first != last; ++first) {
+            const Expense &e = *first;
+            if (containsId(e.id) || (!e.id.empty() && !batchIds.insert(e.id).second)) {
+                skipped++;
+                continue;
+            }
+            table.append(e);
+        }
+        if (skipped > 0)
+            std::cerr << "Warning: skipped " << skipped << " expense(s) with an id that is already taken.\n";
+        commitAppended(start);
+        return table.size() - start;
+    }
+
+    // Append every row of a CSV file (header skipped), parsed in place from
+    // a memory mapping. Rows with an invalid date are skipped. Returns the
+    // number of rows added.
+    size_t importCsv(const std::string &path) {
+        MappedFile file(path);
+        if (!file.isOpen()) {
+            std::cerr << "Error: Could not open " << path << std::endl;
+            return 0;
+        }
+        size_t start = table.size();
+        DateValidator validator;
+        warnRejected(loadMapped(file.view(), &validator));
+        commitAppended(start);
+        return table.size() - start;
+    }
+
+    // Append every row of a CSV stream (e.g. stdin), read in fixed-size blocks;
+    // rows with an invalid date are skipped
+    size_t importCsv(std::istream &in) {
+        size_t start = table.size();
+        std::string buf;
+        std::vector<char> block(1u << 20);
+        bool header = true;
+        DateValidator validator;
+        size_t rejected = 0;
+        while (in) {
+            in.read(block.data(), static_cast<std::streamsize>(block.size()));
+            buf.append(block.data(), static_cast<size_t>(in.gcount()));
+            // Parse complete lines, keep the partial tail for the next block
+            size_t end = in ? buf.rfind('\n') : buf.size();
+            if (end == std::string::npos) continue;
+            if (end < buf.size()) end++;
+            forEachCsvLine(std::string_view(buf.data(), end), [&](std::string_view line) {
+                if (!appendRow(table, splitCsvRow(line), &validator)) rejected++;
+            }, header);
+            header = false;
+            buf.erase(0, end);
+        }
+        warnRejected(rejected);
+        commitAppended(start);
+        return table.size() - start;
+    }
+
+    // Live expenses
+    size_t size() const {
+        return table.liveCount();
+    }
+
+    // Tombstoned rows waiting for the next compaction
+    size_t deadRows() const {
+        return table.deadCount();
+    }
+
+    // Copy of the expense in row i (file order, dead rows included)
+    Expense at(size_t i) const {
+        return table.materialize(i);
+    }
+
+    // Column storage, for scans that should not materialize rows
+    const ExpenseTable &columns() const {
+        return table;
+    }
+
+    // Rows matching query, as views into the store (valid until it is reloaded)
+    QueryResult find(const ExpenseQuery &query) const {
+        return QueryResult(table, query.select(table, &dateIndex, wordIndex(query)));
     }
 
-    // Add new expense
-    void addExpense(const Expense &e) {
-        expenses.push_back(e);
-        save();
+    // Sum, count, min, max and average per category over the rows matching
+    // query, sorted by category
+    std::vector<CategoryStats> summarize(const ExpenseQuery &query) const {
+        std::vector<CategoryStats> result;
+        std::vector<KernelStats> stats = query.aggregate(table, &dateIndex, wordIndex(query));
+        for (uint32_t code : table.categoryDictionary().sortedCodes()) {
+            if (stats[code].count == 0) continue;
+            result.push_back(toCategoryStats(table.categoryName(code), stats[code]));
+        }
+        return result;
     }
 
     // List all expenses
     void listExpenses() const {
         std::cout << "\n--- All Expenses ---\n";
-        if (expenses.empty()) {
+        if (size() == 0) {
             std::cout << "No expenses found.\n";
             return;
         }
         
-        // Print header
-        std::cout << std::left << std::setw(8) << "ID" 
-                  << std::setw(12) << "Date" 
-                  << std::setw(10) << "Amount"
-                  << std::setw(15) << "Category" 
-                  << "Description" << std::endl;
-        std::cout << std::string(60, '-') << std::endl;
-        
-        for (const auto &e : expenses) e.display();
+        ExpenseWriter writer(std::cout);
+        writer.header();
+        for (size_t i = 0; i < table.size(); i++) {
+            if (table.isLive(i)) writer.row(table, i);
+        }
     }
 
     // Filter by date range
     void filterByDate(const std::string &start, const std::string &end) const {
         std::cout << "\n--- Filtered Expenses (" << start << " to " << end << ") ---\n";
-        for (const auto &e : expenses) {
-            if (e.date >= start && e.date <= end)
-                e.display();
-        }
+        if (parseDate(start) == kNoDate || parseDate(end) == kNoDate) return;
+        displayRows(find(ExpenseQuery().between(start, end)));
+    }
+
+    // Expenses dated start..end (inclusive, YYYY-MM-DD), in file order.
+    // Only rows inside the range are touched, via the date index.
+    std::vector<Expense> queryByDate(const std::string &start, const std::string &end) const {
+        if (parseDate(start) == kNoDate || parseDate(end) == kNoDate) return std::vector<Expense>();
+        return find(ExpenseQuery().between(start, end)).materialize();
     }
 
     // Filter by category
     void filterByCategory(const std::string &cat) const {
         std::cout << "\n--- Category: " << cat << " ---\n";
-        for (const auto &e : expenses) {
-            if (e.category == cat)
-                e.display();
-        }
+        displayRows(find(ExpenseQuery().inCategory(cat)));
     }
 
     // Summarize by category
     void summarizeByCategory() const {
-        std::map<std::string, double> totals;
-        double grandTotal = 0.0;
-
-        for (const auto &e : expenses) {
-            totals[e.category] += e.amount;
-            grandTotal += e.amount;
-        }
+        // One kernel pass into a flat array indexed by category code
+        std::vector<KernelStats> totals = ExpenseQuery().aggregate(table, &dateIndex);
+        int64_t grandTotal = 0;
+        for (const KernelStats &t : totals) grandTotal += t.sum;
 
         std::cout << "\n--- Summary by Category ---\n";
-        for (const auto &[cat, total] : totals) {
-            std::cout << std::left << std::setw(15) << cat
-                      << " $" << std::fixed << std::setprecision(2)
-                      << total << std::endl;
+        for (uint32_t code : table.categoryDictionary().sortedCodes()) {
+            // A category whose rows were all deleted stays in the dictionary
+            if (totals[code].count == 0) continue;
+            std::cout << std::left << std::setw(15) << table.categoryName(code)
+                      << " $" << Money::fromUnits(totals[code].sum) << '\n';
         }
         std::cout << "-----------------------------\n";
-        std::cout << "Total: $" << std::fixed << std::setprecision(2)
-                  << grandTotal << "\n";
+        std::cout << "Total: $" << Money::fromUnits(grandTotal) << "\n";
+    }
+
+    // Category totals for start..end (inclusive, YYYY-MM-DD), sorted by
+    // category. Answered from the rollup cache without scanning rows.
+    std::vector<CategoryTotal> summarizeRange(const std::string &start, const std::string &end) const {
+        std::vector<CategoryTotal> result;
+        int32_t from = parseDate(start);
+        int32_t to = parseDate(end);
+        if (from == kNoDate || to == kNoDate) return result;
+
+        std::vector<RollupCache::Cell> cells = rollups.totals(from, to);
+        for (uint32_t code : table.categoryDictionary().sortedCodes()) {
+            if (code >= cells.size() || cells[code].count == 0) continue;
+            CategoryTotal t;
+            t.category = table.categoryName(code);
+            t.total = Money::fromUnits(cells[code].cents);
+            t.count = cells[code].count;
+            result.push_back(t);
+        }
+        return result;
+    }
+
+    // Sum, count, min, max and average per category for start..end
+    // (inclusive, YYYY-MM-DD), sorted by category, in one vectorized pass
+    std::vector<CategoryStats> statsByCategory(const std::string &start, const std::string &end) const {
+        if (parseDate(start) == kNoDate || parseDate(end) == kNoDate) return std::vector<CategoryStats>();
+        return summarize(ExpenseQuery().between(start, end));
+    }
+
+    // Sum, count, min, max and average per category over all expenses
+    std::vector<CategoryStats> statsByCategory() const {
+        return summarize(ExpenseQuery());
+    }
+
+    // Stats over every expense dated start..end (inclusive, YYYY-MM-DD)
+    CategoryStats statsInRange(const std::string &start, const std::string &end) const {
+        int32_t from = parseDate(start);
+        int32_t to = parseDate(end);
+        if (from == kNoDate || to == kNoDate) return CategoryStats();
+        if (table.deadCount() > 0) {
+            KernelStats total;
+            for (const KernelStats &k : ExpenseQuery().betweenDays(from, to).aggregate(table, &dateIndex))
+                total.merge(k);
+            return toCategoryStats(std::string(), total);
+        }
+        return toCategoryStats(std::string(), aggregateRange(table.dayData(), table.amountData(),
+                                                             table.size(), from, to));
     }
 };
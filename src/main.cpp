@@ -2,69 +2,11 @@
 #include "../include/expense.h"
 #include <iostream>
 #include <iomanip>
-#include <ctime>
-#include <cstdlib>
-#include <regex>
-#include <chrono>
 #include <fstream>
 #include "expense_store.cpp" // for simplicity in single build
-
-// Generate a pseudo-random ID
-std::string generateID() {
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
-    return "E" + std::to_string(std::rand() % 1000000);
-}
-
-// Date validation function
-bool isValidDate(const std::string& dateStr) {
-    // Check format: YYYY-MM-DD
-    std::regex dateRegex(R"(^\d{4}-\d{2}-\d{2}$)");
-    if (!std::regex_match(dateStr, dateRegex)) {
-        return false;
-    }
-    
-    // Parse the date components
-    int year, month, day;
-    if (sscanf(dateStr.c_str(), "%d-%d-%d", &year, &month, &day) != 3) {
-        return false;
-    }
-    
-    // Basic range checks
-    if (year < 1900 || year > 2100) return false;
-    if (month < 1 || month > 12) return false;
-    if (day < 1 || day > 31) return false;
-    
-    // Check for valid days in each month
-    int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    
-    // Handle leap year for February
-    if (month == 2) {
-        bool isLeapYear = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-        if (isLeapYear) {
-            daysInMonth[1] = 29;
-        }
-    }
-    
-    if (day > daysInMonth[month - 1]) {
-        return false;
-    }
-    
-    // Check if date is not in the future
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    
-    int currentYear = tm.tm_year + 1900;
-    int currentMonth = tm.tm_mon + 1;
-    int currentDay = tm.tm_mday;
-    
-    // Allow dates up to today
-    if (year > currentYear) return false;
-    if (year == currentYear && month > currentMonth) return false;
-    if (year == currentYear && month == currentMonth && day > currentDay) return false;
-    
-    return true;
-}
+#include "concurrent_store.cpp"
+#include "expense_service.cpp"
+#include "batch_cli.cpp"
 
 // Get validated date input from user
 std::string getValidDate() {
@@ -82,7 +24,7 @@ std::string getValidDate() {
     }
 }
 
-int main() {
+int main(int argc, char **argv) {
     // Try different possible paths for the CSV file
     std::string csvPath = "data/sample_expenses.csv";
     std::ifstream testFile(csvPath);
@@ -94,8 +36,14 @@ int main() {
         }
     }
     testFile.close();
+
+    // Any arguments select the non-interactive command mode
+    if (argc > 1) {
+        return runBatch(argc, argv, csvPath);
+    }
     
     ExpenseStore store(csvPath);
+    store.enableJournal();
 
     int choice;
     do {
@@ -124,7 +72,7 @@ int main() {
 
         if (choice == 1) {
             Expense e;
-            e.id = generateID();
+            e.id = store.nextId();
             e.date = getValidDate();
             std::cout << "Enter amount: ";
             
@@ -140,8 +88,7 @@ int main() {
             std::getline(std::cin, e.category);
             std::cout << "Enter description: ";
             std::getline(std::cin, e.description);
-            store.addExpense(e);
-            std::cout << "Expense added successfully!\n";
+            if (store.addExpense(e)) std::cout << "Expense added successfully!\n";
         }
         else if (choice == 2) {
             store.listExpenses();
@@ -173,6 +120,9 @@ int main() {
         }
     } while (choice != 0);
 
+    // Fold this session's journal back into the CSV file
+    store.compact();
+
     std::cout << "\nGoodbye!\n";
     return 0;
 }
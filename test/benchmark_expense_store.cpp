@@ -0,0 +1,393 @@
+// test/benchmark_expense_store.cpp
+#include "../include/expense.h"
+#include "../src/expense_store.cpp"
+#include "../src/concurrent_store.cpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Performance benchmarks for ExpenseStore.
+//
+//   expense_benchmarks [--rows 1000,100000,...] [--categories N] [--days N]
+//                      [--iterations N] [--budget SECONDS] [--reps N] [--dir PATH]
+//                      [--seed N] [--baseline FILE] [--tolerance FRACTION]
+//                      [--threads 1,2,4,...]
+//
+// For each row count a synthetic ledger is generated, then load, save,
+// add, filterByDate, filterByCategory and summarizeByCategory are timed.
+// concurrentRead_tN runs N threads that each take a ConcurrentExpenseStore
+// snapshot and query it; its per_sec is the total over all threads, so it
+// shows how reads scale with the thread count.
+// Every result is one JSON line on stdout; progress goes to stderr. With
+// --baseline, results are compared with an earlier run and the exit
+// status is 1 if any throughput dropped by more than the tolerance.
+// Build with CMAKE_BUILD_TYPE=Release for numbers worth comparing.
+
+// Shape of a generated ledger
+struct LedgerSpec {
+    size_t rows = 1000;
+    size_t categories = 20;
+    int32_t days = 3650;                           // dates spread over this many days
+    int32_t lastDay = daysFromCivil(2025, 12, 31);
+    double outOfOrder = 0.05;                      // share of rows not in date order
+    uint64_t seed = 42;
+};
+
+// Write a synthetic ledger as CSV: ids E1..En, dates rising across the
+// spread with a share out of order, amounts 0.01..999.99, categories
+// Cat0..CatK-1 skewed towards the first ones, and short descriptions from
+// a fixed vocabulary.
+bool writeSyntheticLedger(const std::string &path, const LedgerSpec &spec) {
+    static const char *const kWords[] = {"lunch", "dinner", "coffee", "groceries", "uber", "taxi",
+                                         "airport", "rent", "power", "internet", "books", "gift",
+                                         "pharmacy", "gym", "cinema", "parking", "hotel", "train"};
+    const size_t wordCount = sizeof(kWords) / sizeof(kWords[0]);
+    std::FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: could not write " << path << "\n";
+        return false;
+    }
+    std::mt19937_64 rng(spec.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::string buf = "id,date,amount,category,description\n";
+    int32_t firstDay = spec.lastDay - spec.days + 1;
+    for (size_t i = 0; i < spec.rows; i++) {
+        int32_t day = firstDay + static_cast<int32_t>(static_cast<double>(i) * spec.days / spec.rows);
+        if (unit(rng) < spec.outOfOrder) day = firstDay + static_cast<int32_t>(rng() % spec.days);
+        double u = unit(rng);
+        size_t category = std::min(spec.categories - 1, static_cast<size_t>(u * u * spec.categories));
+
+        buf += 'E';
+        buf += std::to_string(i + 1);
+        buf += ',';
+        char date[10];
+        buf.append(date, formatDate(day, date));
+        buf += ',';
+        char amount[32];
+        buf.append(amount, Money::fromUnits(1 + static_cast<int64_t>(rng() % 99999)).format(amount));
+        buf += ",Cat";
+        buf += std::to_string(category);
+        buf += ',';
+        buf += kWords[rng() % wordCount];
+        buf += ' ';
+        buf += kWords[rng() % wordCount];
+        buf += '\n';
+        if (buf.size() >= (1u << 20)) {
+            std::fwrite(buf.data(), 1, buf.size(), out);
+            buf.clear();
+        }
+    }
+    std::fwrite(buf.data(), 1, buf.size(), out);
+    return std::fclose(out) == 0;
+}
+
+// Peak resident set size of the process so far, in KiB
+size_t peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return static_cast<size_t>(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+// Swallows the listings that the filter and summary commands print
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+class QuietStdout {
+private:
+    NullBuffer sink;
+    std::streambuf *saved;
+
+public:
+    QuietStdout() : saved(std::cout.rdbuf(&sink)) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+};
+
+class BenchmarkRunner {
+public:
+    struct Result {
+        std::string name;
+        size_t rows = 0;          // ledger size
+        size_t items = 1;         // units of work per sample (rows or operations)
+        std::string unit;         // what items counts
+        std::vector<double> micros;
+    };
+
+    size_t iterations = 200;      // samples per operation benchmark
+    double budget = 2.0;          // ...unless this many seconds run out first
+    size_t reps = 3;              // samples for load and save
+    std::vector<size_t> threads;  // reader thread counts for concurrentRead
+    std::vector<Result> results;
+
+    using Clock = std::chrono::steady_clock;
+
+    static double since(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    static double percentile(const std::vector<double> &sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t k = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(k, sorted.size() - 1)];
+    }
+
+    // Items per second at the median sample
+    static double perSecond(const Result &r) {
+        std::vector<double> sorted = r.micros;
+        std::sort(sorted.begin(), sorted.end());
+        double p50 = percentile(sorted, 0.50);
+        return p50 > 0 ? static_cast<double>(r.items) * 1e6 / p50 : 0;
+    }
+
+    // Time fn() up to n times (at least three), within the time budget
+    template <typename Fn>
+    Result measure(const std::string &name, size_t rows, size_t items, const std::string &unit,
+                   size_t n, Fn &&fn) {
+        Result r;
+        r.name = name;
+        r.rows = rows;
+        r.items = items;
+        r.unit = unit;
+        Clock::time_point begin = Clock::now();
+        for (size_t k = 0; k < n; k++) {
+            Clock::time_point start = Clock::now();
+            fn(k);
+            r.micros.push_back(since(start));
+            if (k >= 2 && since(begin) > budget * 1e6) break;
+        }
+        report(r);
+        results.push_back(r);
+        return r;
+    }
+
+    static void report(const Result &r) {
+        std::vector<double> sorted = r.micros;
+        std::sort(sorted.begin(), sorted.end());
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "{\"benchmark\":\"%s\",\"rows\":%zu,\"samples\":%zu,\"unit\":\"%s\","
+                      "\"per_sec\":%.1f,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,"
+                      "\"max_us\":%.1f,\"peak_rss_kb\":%zu}\n",
+                      r.name.c_str(), r.rows, sorted.size(), r.unit.c_str(), perSecond(r),
+                      percentile(sorted, 0.50),
+                      percentile(sorted, 0.90), percentile(sorted, 0.99),
+                      sorted.empty() ? 0.0 : sorted.back(), peakRssKb());
+        std::cout << line << std::flush;
+    }
+
+    // Every benchmark on one generated ledger
+    bool run(const LedgerSpec &spec, const std::string &dir) {
+        std::string path = dir + "/bench_" + std::to_string(spec.rows) + ".csv";
+        std::remove((path + ".journal").c_str());
+        std::cerr << "Generating " << spec.rows << " rows...\n";
+        if (!writeSyntheticLedger(path, spec)) return false;
+
+        std::mt19937_64 rng(spec.seed + 1);
+        int32_t firstDay = spec.lastDay - spec.days + 1;
+        {
+            // Each sample loads from scratch; the store of the last one is kept
+            std::unique_ptr<ExpenseStore> store;
+            measure("load", spec.rows, spec.rows, "rows", reps, [&](size_t) {
+                store.reset();
+                store.reset(new ExpenseStore(path));
+            });
+
+            measure("filterByDate", spec.rows, 1, "queries", iterations, [&](size_t) {
+                int32_t from = firstDay + static_cast<int32_t>(rng() % spec.days);
+                QuietStdout quiet;
+                store->filterByDate(formatDate(from), formatDate(from + 30));
+            });
+
+            measure("filterByCategory", spec.rows, 1, "queries", iterations, [&](size_t) {
+                std::string category = "Cat" + std::to_string(rng() % spec.categories);
+                QuietStdout quiet;
+                store->filterByCategory(category);
+            });
+
+            measure("summarizeByCategory", spec.rows, 1, "queries", iterations, [&](size_t) {
+                QuietStdout quiet;
+                store->summarizeByCategory();
+            });
+
+            // Journaled adds with group commit, as command mode runs them
+            store->enableJournal(SIZE_MAX);
+            measure("add", spec.rows, 1, "adds", iterations, [&](size_t k) {
+                Expense e;
+                e.id = "B" + std::to_string(k);
+                e.date = formatDate(firstDay + static_cast<int32_t>(rng() % spec.days));
+                e.amount = Money::fromUnits(static_cast<int64_t>(rng() % 99999));
+                e.category = "Cat" + std::to_string(rng() % spec.categories);
+                e.description = "benchmark add";
+                store->addExpense(e);
+            });
+            store->sync();
+
+            measure("save", spec.rows, spec.rows, "rows", reps, [&](size_t) {
+                store->save();
+            });
+        }
+        {
+            // Each thread takes a snapshot and reads one day per query
+            ConcurrentExpenseStore store(path);
+            const size_t queriesPerThread = 2000;
+            for (size_t n : threads) {
+                if (n == 0) continue;
+                measure("concurrentRead_t" + std::to_string(n), spec.rows, n * queriesPerThread,
+                        "queries", reps, [&](size_t) {
+                    std::vector<std::thread> readers;
+                    for (size_t t = 0; t < n; t++) {
+                        readers.emplace_back([&store, &spec, firstDay, t]() {
+                            std::mt19937_64 local(spec.seed + t);
+                            for (size_t q = 0; q < queriesPerThread; q++) {
+                                int32_t day = firstDay + static_cast<int32_t>(local() % spec.days);
+                                ConcurrentExpenseStore::Snapshot snap = store.snapshot();
+                                snap.find(ExpenseQuery().betweenDays(day, day).limit(1));
+                            }
+                        });
+                    }
+                    for (std::thread &t : readers) t.join();
+                });
+            }
+        }
+        std::remove(path.c_str());
+        std::remove((path + ".journal").c_str());
+        std::remove((path + ".tmp").c_str());
+        return true;
+    }
+};
+
+// Value of "key" in one of our JSON lines ("" if absent)
+std::string jsonField(const std::string &line, const std::string &key) {
+    std::string tag = "\"" + key + "\":";
+    size_t p = line.find(tag);
+    if (p == std::string::npos) return std::string();
+    p += tag.size();
+    if (p < line.size() && line[p] == '"') {
+        size_t end = line.find('"', p + 1);
+        return line.substr(p + 1, end == std::string::npos ? std::string::npos : end - p - 1);
+    }
+    size_t end = line.find_first_of(",}", p);
+    return line.substr(p, end == std::string::npos ? std::string::npos : end - p);
+}
+
+// Compare throughput with an earlier run; returns the number of regressions
+size_t compareWithBaseline(const std::vector<BenchmarkRunner::Result> &results,
+                           const std::string &baselinePath, double tolerance) {
+    std::ifstream in(baselinePath);
+    if (!in.is_open()) {
+        std::cerr << "Error: could not read baseline " << baselinePath << "\n";
+        return 1;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string name = jsonField(line, "benchmark");
+        if (name.empty()) continue;
+        baseline[name + "@" + jsonField(line, "rows")] = std::atof(jsonField(line, "per_sec").c_str());
+    }
+
+    size_t regressions = 0;
+    for (const BenchmarkRunner::Result &r : results) {
+        auto it = baseline.find(r.name + "@" + std::to_string(r.rows));
+        if (it == baseline.end() || it->second <= 0) continue;
+        double perSec = BenchmarkRunner::perSecond(r);
+        double change = perSec / it->second - 1.0;
+        if (change < -tolerance) {
+            regressions++;
+            std::cerr << "REGRESSION " << r.name << " @ " << r.rows << " rows: " << perSec << " "
+                      << r.unit << "/s vs " << it->second << " (" << change * 100 << "%)\n";
+        }
+    }
+    return regressions;
+}
+
+// "1,2,4" -> {1, 2, 4}
+std::vector<size_t> parseList(const std::string &value) {
+    std::vector<size_t> list;
+    size_t p = 0;
+    while (p < value.size()) {
+        size_t end = value.find(',', p);
+        if (end == std::string::npos) end = value.size();
+        list.push_back(std::strtoull(value.substr(p, end - p).c_str(), nullptr, 10));
+        p = end + 1;
+    }
+    return list;
+}
+
+int main(int argc, char **argv) {
+    LedgerSpec spec;
+    BenchmarkRunner runner;
+    std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    std::string dir = ".", baselinePath;
+    double tolerance = 0.15;
+    unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+    for (size_t n = 1; n <= cores; n *= 2) runner.threads.push_back(n);
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i], value = argv[i + 1];
+        if (arg == "--rows") {
+            sizes = parseList(value);
+        } else if (arg == "--threads") {
+            runner.threads = parseList(value);
+        } else if (arg == "--categories") {
+            spec.categories = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        } else if (arg == "--days") {
+            spec.days = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--iterations") {
+            runner.iterations = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--budget") {
+            runner.budget = std::atof(value.c_str());
+        } else if (arg == "--reps") {
+            runner.reps = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--dir") {
+            dir = value;
+        } else if (arg == "--seed") {
+            spec.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--baseline") {
+            baselinePath = value;
+        } else if (arg == "--tolerance") {
+            tolerance = std::atof(value.c_str());
+        } else {
+            std::cerr << "Error: unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+
+    for (size_t rows : sizes) {
+        if (rows == 0) continue;
+        spec.rows = rows;
+        if (!runner.run(spec, dir)) return 2;
+    }
+
+    if (!baselinePath.empty() && compareWithBaseline(runner.results, baselinePath, tolerance) > 0)
+        return 1;
+    return 0;
+}
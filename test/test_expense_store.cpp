@@ -1,9 +1,18 @@
 // test/test_expense_store.cpp
 #include "../include/expense.h"
 #include "../src/expense_store.cpp"
+#include "../include/csv_stream_query.h"
+#include "../src/concurrent_store.cpp"
+#include "../src/expense_service.cpp"
+#include <thread>
+#include <atomic>
+#include <unordered_set>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <cassert>
+#include <cmath>
+#include <sstream>
 
 class TestFramework {
 private:
@@ -126,6 +135,22 @@ void test_date_filtering() {
     bool in_range = (test_date >= start_date) && (test_date <= end_date);
     tf.run_test("Date range filtering logic", in_range);
     
+    std::vector<Expense> hits = store.queryByDate(start_date, end_date);
+    tf.run_test("Date range query returns matching rows",
+                hits.size() == 2 && hits[0].id == "E1001" && hits[1].id == "E1002");
+    
+    // Out-of-order add lands in the index delta
+    Expense late;
+    late.id = "E1004";
+    late.date = "2024-01-16";
+    late.amount = 5.00;
+    late.category = "Food";
+    late.description = "Coffee";
+    store.addExpense(late);
+    hits = store.queryByDate("2024-01-16", "2024-01-25");
+    tf.run_test("Date index sees out-of-order add",
+                hits.size() == 3 && hits[0].id == "E1002" && hits[2].id == "E1004");
+    
     // Clean up
     std::remove(test_file.c_str());
 }
@@ -164,6 +189,8 @@ void test_csv_parsing_with_commas() {
     
     ExpenseStore store(test_file);
     tf.run_test("CSV parsing with commas in description", true);
+    tf.run_test("Description keeps the rest of the line",
+                store.size() == 2 && store.at(0).description == "Lunch, with friends");
     
     // Clean up
     std::remove(test_file.c_str());
@@ -191,7 +218,1442 @@ void test_error_handling() {
     std::remove(test_file.c_str());
 }
 
+// Test fixed-point money type
+void test_money_type() {
+    TestFramework tf;
+    
+    Money total;
+    for (int i = 0; i < 10; i++) total += Money(0.10);
+    tf.run_test("Cents accumulate exactly", total == Money(1.00) && total.raw() == 100);
+    
+    Money parsed;
+    tf.run_test("Parse without double", Money::parse("1234567.89", parsed) &&
+                parsed.raw() == 123456789);
+    tf.run_test("Parse rounds extra decimals", Money::parse("-0.505", parsed) &&
+                parsed.raw() == -51);
+    tf.run_test("Format round-trips", Money::fromUnits(-5).toString() == "-0.05" &&
+                Money::fromUnits(120000).toString() == "1200.00");
+}
+
+// Test loader edge cases: empty lines, bad amounts, missing file end newline
+void test_loader_edge_cases() {
+    TestFramework tf;
+    
+    std::string test_file = "test_loader.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "\n";
+    file << "E1001,2024-01-15,abc,Food,Lunch\n";
+    file << "E1002,2024-01-16, 12.25,Transport,Gas\n";
+    file << "E1003,2024-01-17";
+    file.close();
+    
+    ExpenseStore store(test_file);
+    tf.run_test("Empty lines skipped", store.size() == 3);
+    tf.run_test("Bad amount becomes 0", store.at(0).amount == 0.0);
+    tf.run_test("Amount with leading blank parsed", store.at(1).amount == 12.25);
+    tf.run_test("Short last row keeps id and date",
+                store.at(2).id == "E1003" && store.at(2).date == "2024-01-17" &&
+                store.at(2).category.empty());
+    
+    // Dates that do not parse are written back exactly as they were read
+    std::string snap_file = test_file + ".snap";
+    std::remove(snap_file.c_str());
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream odd(test_file);
+    odd << "id,date,amount,category,description\n";
+    odd << "E1,2024/01/15,10.00,Food,Lunch\n";
+    odd << "E2,2024-01-16,5.00,Food,Tea\n";
+    odd << "E3,01-15-2024,2.00,Food,Snack\n";
+    odd.close();
+    {
+        ExpenseStore loaded(test_file);
+        loaded.enableJournal();
+        loaded.deleteExpense("E2");
+    }
+    {
+        ExpenseStore replayed(test_file);
+        tf.run_test("Unparsed date kept through journal replay",
+                    replayed.size() == 2 && replayed.at(0).date == "2024/01/15" &&
+                    replayed.at(1).date == "01-15-2024");
+        replayed.compact();
+    }
+    std::ifstream saved(test_file);
+    std::string content((std::istreambuf_iterator<char>(saved)), std::istreambuf_iterator<char>());
+    saved.close();
+    tf.run_test("Unparsed date written back unchanged",
+                content.find("E1,2024/01/15,10.00,Food,Lunch") != std::string::npos &&
+                content.find("E3,01-15-2024,2.00,Food,Snack") != std::string::npos);
+    
+    StoreOptions options;
+    options.snapshot = true;
+    { ExpenseStore first(test_file, options); }
+    ExpenseStore fromSnap(test_file, options);
+    tf.run_test("Unparsed date kept in snapshot",
+                fromSnap.size() == 2 && fromSnap.at(1).date == "01-15-2024");
+    
+    // Clean up
+    std::remove(test_file.c_str());
+    std::remove(snap_file.c_str());
+}
+
+// Test parallel chunked loading keeps file order
+void test_parallel_load() {
+    TestFramework tf;
+    
+    std::string test_file = "test_parallel.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    for (int i = 0; i < 1000; i++) {
+        file << "E" << i << ",2024-01-15," << i << ".25,Food,Item " << i << "\n";
+    }
+    file.close();
+    
+    ExpenseStore store(test_file);
+    store.setLoadThreads(4);
+    store.load();
+    
+    bool in_order = store.size() == 1000;
+    for (size_t i = 0; in_order && i < store.size(); i++) {
+        in_order = store.at(i).id == "E" + std::to_string(i);
+    }
+    tf.run_test("Parallel load reads every row", store.size() == 1000);
+    tf.run_test("Parallel load preserves file order", in_order);
+    
+    // Clean up
+    std::remove(test_file.c_str());
+}
+
+// Test columnar storage round-trips rows
+void test_columnar_storage() {
+    TestFramework tf;
+    
+    std::string test_file = "test_columns.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file << "E1002,2024-02-29,50.00,Transport,Gas\n";
+    file << "E1003,2024-01-17,15.75,Food,Snacks, chips\n";
+    file.close();
+    
+    ExpenseStore store(test_file);
+    const ExpenseTable &cols = store.columns();
+    tf.run_test("Categories dictionary-encoded", cols.categoryCount() == 2 &&
+                cols.categoryCode(0) == cols.categoryCode(2));
+    tf.run_test("Date packed as day number", cols.day(0) == daysFromCivil(2024, 1, 15));
+    tf.run_test("Id and description views", cols.id(2) == "E1003" &&
+                cols.description(2) == "Snacks, chips");
+    
+    Expense e = store.at(1);
+    tf.run_test("Row materialized for display", e.id == "E1002" && e.date == "2024-02-29" &&
+                e.amount == 50.00 && e.category == "Transport" && e.description == "Gas");
+    
+    // Clean up
+    std::remove(test_file.c_str());
+}
+
+// Test rollup cache matches a full scan
+void test_rollup_cache() {
+    TestFramework tf;
+    
+    std::string test_file = "test_rollup.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file << "E1002,2024-01-31,50.00,Transport,Gas\n";
+    file << "E1003,2024-02-01,15.75,Food,Snacks\n";
+    file << "E1004,2024-03-10,120.00,Rent,Rent\n";
+    file << "E1005,2024-03-31,0.10,Food,Gum\n";
+    file.close();
+    
+    ExpenseStore store(test_file);
+    
+    // Partial January + all of February + partial March
+    std::vector<CategoryTotal> totals = store.summarizeRange("2024-01-20", "2024-03-15");
+    tf.run_test("Range summary categories", totals.size() == 3);
+    tf.run_test("Range summary totals",
+                totals[0].category == "Food" && totals[0].total == 15.75 && totals[0].count == 1 &&
+                totals[1].category == "Rent" && totals[1].total == 120.00 &&
+                totals[2].category == "Transport" && totals[2].total == 50.00);
+    
+    // Whole-period summary matches a row scan, including an incremental add
+    Expense e;
+    e.id = "E1006";
+    e.date = "2024-02-10";
+    e.amount = 0.20;
+    e.category = "Food";
+    e.description = "Mint";
+    store.addExpense(e);
+    
+    Money scan;
+    for (size_t i = 0; i < store.size(); i++) {
+        if (store.at(i).category == "Food") scan += store.at(i).amount;
+    }
+    totals = store.summarizeRange("2024-01-01", "2024-12-31");
+    tf.run_test("Rollup total matches full scan",
+                totals[0].category == "Food" && totals[0].total == scan && totals[0].count == 4);
+    
+    std::vector<CategoryStats> stats = store.statsByCategory("2024-01-01", "2024-12-31");
+    tf.run_test("Category stats min/max/average",
+                stats[0].category == "Food" && stats[0].total == scan && stats[0].min == 0.10 &&
+                stats[0].max == 25.50 && stats[0].average() == Money::fromUnits(4155 / 4));
+    tf.run_test("Range stats over all categories",
+                store.statsInRange("2024-03-01", "2024-03-31").total == 120.10);
+    
+    // Clean up
+    std::remove(test_file.c_str());
+}
+
+// Test vectorized aggregation kernels agree with the scalar path
+void test_aggregation_kernels() {
+    TestFramework tf;
+    
+    std::vector<int32_t> days;
+    std::vector<uint32_t> cats;
+    std::vector<int64_t> amounts;
+    for (int i = 0; i < 1003; i++) {
+        days.push_back(19700 + (i * 7) % 365);
+        cats.push_back(static_cast<uint32_t>(i % 5));
+        amounts.push_back((i * 37) % 5000 - 100);
+    }
+    
+    KernelStats scalar = aggregateRangeScalar(days.data(), amounts.data(), days.size(), 19750, 19900);
+    KernelStats fast = aggregateRange(days.data(), amounts.data(), days.size(), 19750, 19900);
+    tf.run_test("Range kernel matches scalar", scalar.sum == fast.sum && scalar.count == fast.count &&
+                scalar.min == fast.min && scalar.max == fast.max);
+    
+    std::vector<KernelStats> expected(5);
+    aggregateByCategoryScalar(days.data(), cats.data(), amounts.data(), days.size(),
+                              19750, 19900, expected.data());
+    std::vector<KernelStats> actual = aggregateByCategory(days.data(), cats.data(), amounts.data(),
+                                                          days.size(), 5, 19750, 19900);
+    bool same = true;
+    for (int c = 0; c < 5; c++) {
+        same = same && expected[c].sum == actual[c].sum && expected[c].count == actual[c].count &&
+               expected[c].min == actual[c].min && expected[c].max == actual[c].max;
+    }
+    tf.run_test("Category kernel matches scalar", same);
+}
+
+// Test category dictionary interning
+void test_category_dictionary() {
+    TestFramework tf;
+    
+    CategoryDictionary dict;
+    uint32_t food = dict.intern("Food");
+    uint32_t rent = dict.intern("Rent");
+    tf.run_test("Interning is idempotent", dict.intern("Food") == food && dict.size() == 2);
+    tf.run_test("Lookup of unknown category", dict.find("Travel") == CategoryDictionary::kNotFound);
+    
+    CategoryDictionary copy = dict;
+    tf.run_test("Copied dictionary keeps codes", copy.find("Rent") == rent);
+    
+    dict.intern("Bills");
+    std::vector<uint32_t> order = dict.sortedCodes();
+    tf.run_test("Codes sorted by name", order.size() == 3 && dict.name(order[0]) == "Bills" &&
+                dict.name(order[2]) == "Rent");
+}
+
+// Test binary snapshot write, reload and staleness
+void test_binary_snapshot() {
+    TestFramework tf;
+    
+    std::string test_file = "test_snapshot.csv";
+    std::string snap_file = test_file + ".snap";
+    std::remove(snap_file.c_str());
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file << "E1002,2024-01-16,50.00,Transport,Gas, for car\n";
+    file.close();
+    
+    StoreOptions options;
+    options.snapshot = true;
+    {
+        ExpenseStore store(test_file, options);
+        std::ifstream snap(snap_file);
+        tf.run_test("Snapshot written after CSV parse", snap.is_open());
+    }
+    
+    ExpenseStore fromSnap(test_file, options);
+    Expense e = fromSnap.at(1);
+    tf.run_test("Snapshot reload keeps rows", fromSnap.size() == 2 && e.id == "E1002" &&
+                e.date == "2024-01-16" && e.amount == 50.00 && e.description == "Gas, for car" &&
+                fromSnap.columns().categoryCount() == 2);
+    
+    // A rewrite within the same second and of the same size is still seen
+    std::ofstream rewritten(test_file);
+    rewritten << "id,date,amount,category,description\n";
+    rewritten << "E1001,2024-01-15,95.50,Food,Lunch\n";
+    rewritten << "E1002,2024-01-16,50.00,Transport,Gas, for car\n";
+    rewritten.close();
+    ExpenseStore sameSize(test_file, options);
+    tf.run_test("Same-size rewrite makes snapshot stale",
+                sameSize.size() == 2 && sameSize.at(0).amount == 95.50);
+    
+    // A changed CSV makes the snapshot stale
+    std::ofstream changed(test_file, std::ios::app);
+    changed << "E1003,2024-01-17,15.75,Food,Snacks\n";
+    changed.close();
+    ExpenseStore stale(test_file, options);
+    tf.run_test("Stale snapshot falls back to CSV", stale.size() == 3);
+    
+    // Deleting the CSV deletes its rows, even though the snapshot survives
+    std::string csvText;
+    {
+        std::ifstream in(test_file, std::ios::binary);
+        csvText.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::remove(test_file.c_str());
+    {
+        ExpenseStore deleted(test_file, options);
+        tf.run_test("Snapshot of a deleted CSV is stale", deleted.size() == 0);
+    }
+    std::ofstream restored(test_file, std::ios::binary);
+    restored << csvText;
+    restored.close();
+    
+    // Snapshot-only mode never rewrites the CSV
+    options.csv = false;
+    std::remove(snap_file.c_str());
+    {
+        ExpenseStore store(test_file, options);
+        Expense extra = store.at(0);
+        extra.id = "E1004";
+        store.addExpense(extra);
+    }
+    ExpenseStore snapOnly(test_file, options);
+    ExpenseStore csvOnly(test_file);
+    tf.run_test("Snapshot-only store keeps its own rows", snapOnly.size() == 4 && csvOnly.size() == 3);
+    
+    // Clean up
+    std::remove(test_file.c_str());
+    std::remove(snap_file.c_str());
+}
+
+// Test bulk insert and CSV import
+void test_bulk_import() {
+    TestFramework tf;
+    
+    std::string test_file = "test_bulk.csv";
+    std::string import_file = "test_bulk_import.csv";
+    std::remove(test_file.c_str());
+    std::remove((test_file + ".journal").c_str());
+    
+    ExpenseStore store(test_file);
+    store.enableJournal();
+    
+    std::vector<Expense> batch;
+    for (int i = 0; i < 100; i++) {
+        Expense e;
+        e.id = "B" + std::to_string(i);
+        e.date = i % 2 ? "2024-02-10" : "2024-01-10"; // out of date order
+        e.amount = 1.25;
+        e.category = i % 3 ? "Food" : "Travel";
+        e.description = "Bulk row";
+        batch.push_back(e);
+    }
+    size_t added = store.addExpenses(std::move(batch));
+    tf.run_test("Bulk insert adds every row", added == 100 && store.size() == 100);
+    tf.run_test("Bulk insert journals each row once", store.journalRecords() == 100);
+    tf.run_test("Bulk insert updates date index", store.queryByDate("2024-02-01", "2024-02-28").size() == 50);
+    
+    std::ofstream file(import_file);
+    file << "id,date,amount,category,description\n";
+    file << "I1,2024-03-01,10.00,Food,Imported, with comma\n";
+    file << "I2,2024-03-02,20.00,Rent,Imported\n";
+    file.close();
+    tf.run_test("Import CSV file", store.importCsv(import_file) == 2 && store.size() == 102);
+    
+    std::istringstream stream("id,date,amount,category,description\nS1,2024-03-05,5.00,Food,Streamed\nS2,2024-03-06,6.00,Food,Tail");
+    tf.run_test("Import CSV stream", store.importCsv(stream) == 2 && store.at(103).description == "Tail");
+    
+    std::vector<CategoryTotal> march = store.summarizeRange("2024-03-01", "2024-03-31");
+    tf.run_test("Rollups include imported rows", march.size() == 2 && march[0].total == 21.00);
+    
+    ExpenseStore reloaded(test_file);
+    tf.run_test("Bulk rows survive reload", reloaded.size() == 104);
+    
+    // Clean up
+    reloaded.compact();
+    std::remove(test_file.c_str());
+    std::remove(import_file.c_str());
+}
+
+// Test journal mode appends, replays and compacts
+void test_journal_mode() {
+    TestFramework tf;
+    
+    std::string test_file = "test_journal.csv";
+    std::remove(test_file.c_str()); // Clean up
+    std::remove((test_file + ".journal").c_str());
+    
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file.close();
+    
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal(10);
+        
+        Expense e;
+        e.id = "E1002";
+        e.date = "2024-01-16";
+        e.amount = 50.00;
+        e.category = "Transport";
+        e.description = "Gas, for car";
+        store.addExpense(e);
+        e.id = "E1003";
+        store.addExpense(e);
+        tf.run_test("Journal records appended", store.journalRecords() == 2);
+    }
+    
+    // Base file is untouched, the journal holds the new rows
+    std::ifstream base(test_file);
+    std::string line;
+    int line_count = 0;
+    while (std::getline(base, line)) line_count++;
+    base.close();
+    tf.run_test("Base CSV not rewritten in journal mode", line_count == 2);
+    
+    ExpenseStore reloaded(test_file);
+    tf.run_test("Load replays base file and journal", reloaded.size() == 3);
+    
+    reloaded.compact();
+    std::ifstream journal_file(test_file + ".journal");
+    tf.run_test("Compaction removes journal", !journal_file.is_open());
+    
+    ExpenseStore compacted(test_file);
+    tf.run_test("Compacted CSV keeps all expenses", compacted.size() == 3);
+    
+    // A record torn by a crash is cut off before the next append
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal(1);
+        Expense e;
+        e.id = "E1004";
+        e.date = "2024-01-17";
+        e.amount = 4.00;
+        e.category = "Food";
+        e.description = "Tea";
+        store.addExpense(e);
+    }
+    {
+        std::ofstream torn(test_file + ".journal", std::ios::app | std::ios::binary);
+        torn << "A,E1005,2024-01-1";
+    }
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal(1);
+        Expense e;
+        e.id = "E1006";
+        e.date = "2024-01-18";
+        e.amount = 6.00;
+        e.category = "Food";
+        e.description = "Soup";
+        store.addExpense(e);
+    }
+    ExpenseStore recovered(test_file);
+    Expense found;
+    tf.run_test("Torn journal record dropped", !recovered.findById("E1005", found));
+    tf.run_test("Append after torn record replays",
+                recovered.size() == 5 && recovered.findById("E1006", found));
+    
+    // A base file rewritten to the same size (e.g. a compaction that crashed
+    // before the journal was reset) no longer matches the journal
+    std::string baseText;
+    {
+        std::ifstream in(test_file, std::ios::binary);
+        baseText.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::string sameSize = baseText;
+    sameSize.replace(sameSize.find("25.50"), 5, "99.50");
+    {
+        std::ofstream out(test_file, std::ios::binary);
+        out << sameSize;
+    }
+    ExpenseStore rewritten(test_file);
+    tf.run_test("Journal ignored after same-size base rewrite",
+                rewritten.size() == 3 && !rewritten.findById("E1006", found));
+    
+    // The next append moves the stale journal aside instead of writing under it
+    std::string staleFile = test_file + ".journal.stale";
+    std::remove(staleFile.c_str());
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal(1);
+        Expense e;
+        e.id = "E1007";
+        e.date = "2024-01-19";
+        e.amount = 7.00;
+        e.category = "Food";
+        e.description = "Pie";
+        store.addExpense(e);
+    }
+    ExpenseStore afterEdit(test_file);
+    std::ifstream stale(staleFile);
+    tf.run_test("Append after base edit starts a new journal",
+                afterEdit.size() == 4 && afterEdit.findById("E1007", found) && stale.is_open());
+    stale.close();
+    
+    // Clean up
+    std::remove(test_file.c_str());
+    std::remove((test_file + ".journal").c_str());
+    std::remove(staleFile.c_str());
+}
+
+// Test streaming queries over a CSV file
+void test_stream_query() {
+    TestFramework tf;
+    
+    std::string test_file = "test_stream.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file << "E1002,2024-01-20,50.00,Transport,\"Gas, for car\"\n";
+    file << "E1003,2024-02-03,12.25,Food,Coffee\n";
+    file << "E1004,not-a-date,99.99,Food,Unknown\n";
+    file << "E1005,2024-01-31,7.75,Food,Snack"; // no trailing newline
+    file.close();
+    
+    CsvStreamQuery query;
+    query.from = parseDate("2024-01-01");
+    query.to = parseDate("2024-01-31");
+    query.categories.push_back("Food");
+    std::vector<std::string> ids;
+    bool ok = query.scan(test_file, [&](const CsvStreamQuery::Match &m) {
+        ids.emplace_back(m.row.id);
+    });
+    tf.run_test("Stream scan reads file", ok);
+    tf.run_test("Stream scan applies date and category",
+                ids == std::vector<std::string>({"E1001", "E1005"}));
+    
+    CsvStreamQuery amounts;
+    amounts.hasMin = true;
+    amounts.minAmount = Money(20.00);
+    amounts.hasMax = true;
+    amounts.maxAmount = Money(50.00);
+    CsvStreamQuery::Summary summary;
+    amounts.summarize(test_file, summary);
+    uint32_t food = summary.categories.find("Food");
+    uint32_t transport = summary.categories.find("Transport");
+    tf.run_test("Stream summary applies amount bounds",
+                food != CategoryDictionary::kNotFound && summary.stats[food].count == 1 &&
+                summary.stats[food].sum == 2550 &&
+                transport != CategoryDictionary::kNotFound && summary.stats[transport].sum == 5000);
+    
+    CsvStreamQuery::Match m;
+    tf.run_test("Quoted description kept whole",
+                amounts.matchLine("E1002,2024-01-20,50.00,Transport,\"Gas, for car\"", m) &&
+                m.row.description == "\"Gas, for car\"");
+    CsvStreamQuery either;
+    either.categories = {"Transport", "Food"};
+    ids.clear();
+    either.scan(test_file, [&](const CsvStreamQuery::Match &m) { ids.emplace_back(m.row.id); });
+    tf.run_test("Stream scan matches any of several categories", ids.size() == 5);
+    tf.run_test("Stream category set on decoded rows",
+                either.matchFields("E9", 0, Money(1), "Transport", "", m) &&
+                !either.matchFields("E9", 0, Money(1), "Rent", "", m));
+    tf.run_test("Missing file reported", !query.scan("missing_stream.csv", [](const CsvStreamQuery::Match &) {}));
+    
+    // Clean up
+    std::remove(test_file.c_str());
+}
+
+// Test composable queries
+void test_query_builder() {
+    TestFramework tf;
+    
+    std::string test_file = "test_query.csv";
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch with team\n";
+    file << "E1002,2024-01-20,50.00,Transport,Gas refill\n";
+    file << "E1003,2024-02-03,12.25,Food,Coffee\n";
+    file << "E1004,2024-02-10,120.00,Rent,Monthly rent\n";
+    file << "E1005,2024-03-01,8.00,Food,Team lunch\n";
+    file << "E1006,bad-date,5.00,Food,Lunch\n";
+    file.close();
+    
+    ExpenseStore store(test_file);
+    
+    auto ids = [](const QueryResult &r) {
+        std::vector<std::string> out;
+        for (ExpenseView v : r) out.emplace_back(v.id());
+        return out;
+    };
+    
+    tf.run_test("Empty query returns every row", store.find(ExpenseQuery()).size() == 6);
+    tf.run_test("Date range uses file order",
+                ids(store.find(ExpenseQuery().between("2024-01-16", "2024-02-28"))) ==
+                std::vector<std::string>({"E1002", "E1003", "E1004"}));
+    tf.run_test("Open-ended range skips undated rows",
+                store.find(ExpenseQuery().between("", "2024-12-31")).size() == 5);
+    tf.run_test("Category set",
+                ids(store.find(ExpenseQuery().inCategory("Rent").inCategory("Transport"))) ==
+                std::vector<std::string>({"E1002", "E1004"}));
+    tf.run_test("Unknown category matches nothing",
+                store.find(ExpenseQuery().inCategory("Travel")).empty());
+    tf.run_test("Amount bounds",
+                ids(store.find(ExpenseQuery().amountAtLeast(Money(10)).amountAtMost(Money(50)))) ==
+                std::vector<std::string>({"E1001", "E1002", "E1003"}));
+    tf.run_test("Text match ignores case",
+                ids(store.find(ExpenseQuery().contains("LUNCH").between("2024-01-01", "2024-12-31"))) ==
+                std::vector<std::string>({"E1001", "E1005"}));
+    
+    QueryResult top = store.find(ExpenseQuery().inCategory("Food")
+                                     .sortBy(ExpenseQuery::SortKey::Amount, true).limit(2));
+    tf.run_test("Sort descending with limit",
+                ids(top) == std::vector<std::string>({"E1001", "E1003"}) &&
+                top[0].amount() == Money(25.50) && top[0].category() == "Food");
+    tf.run_test("Offset and limit page in file order",
+                ids(store.find(ExpenseQuery().offset(4).limit(5))) ==
+                std::vector<std::string>({"E1005", "E1006"}));
+    tf.run_test("Offset past the end is empty", store.find(ExpenseQuery().offset(10)).empty());
+    tf.run_test("Offset plus a huge limit does not wrap",
+                store.find(ExpenseQuery().offset(2).limit(SIZE_MAX - 1)).size() == 4);
+    tf.run_test("Invalid date bound matches nothing",
+                store.find(ExpenseQuery().between("2024-13-01", "")).empty());
+    
+    std::vector<CategoryStats> stats = store.summarize(
+        ExpenseQuery().between("2024-01-01", "2024-12-31").amountAtMost(Money(30)));
+    tf.run_test("Summarize applies every filter",
+                stats.size() == 1 && stats[0].category == "Food" && stats[0].count == 3 &&
+                stats[0].total == Money(45.75) && stats[0].max == Money(25.50));
+    
+    // Clean up
+    std::remove(test_file.c_str());
+}
+
+// Test buffered output formats
+void test_expense_writer() {
+    TestFramework tf;
+    
+    ExpenseTable table;
+    table.append("E1", parseDate("2024-01-15"), Money(25.50), "Food", "Lunch");
+    table.append("E2", parseDate("2024-01-20"), Money(-3), "Refund", "Say \"hi\"\tnow");
+    
+    std::ostringstream csv;
+    {
+        ExpenseWriter writer(csv, OutputFormat::Csv);
+        writer.header();
+        writer.row(table, 0);
+        tf.run_test("Writer buffers until flush", csv.str().empty());
+    }
+    tf.run_test("CSV output",
+                csv.str() == "id,date,amount,category,description\nE1,2024-01-15,25.50,Food,Lunch\n");
+    
+    std::ostringstream json;
+    {
+        ExpenseWriter writer(json, OutputFormat::Json);
+        writer.row(table, 1);
+    }
+    tf.run_test("JSON lines output escapes text",
+                json.str() == "{\"id\":\"E2\",\"date\":\"2024-01-20\",\"amount\":-3.00,"
+                              "\"category\":\"Refund\",\"description\":\"Say \\\"hi\\\"\\tnow\"}\n");
+    
+    std::ostringstream tableOut;
+    {
+        ExpenseWriter writer(tableOut, OutputFormat::Table, 16);
+        writer.row(table, 0);
+        tf.run_test("Full buffer is written out", !tableOut.str().empty());
+        CategoryStats s;
+        s.category = "Food";
+        s.total = Money(30);
+        s.count = 2;
+        s.min = Money(10);
+        s.max = Money(20);
+        writer.stats(s);
+    }
+    tf.run_test("Table output",
+                tableOut.str() == "E1      2024-01-15  $25.50    Food           Lunch\n"
+                                  "Food           30.00         2       10.00       20.00       15.00\n");
+}
+
+// Test concurrent readers while a writer appends
+void test_concurrent_store() {
+    TestFramework tf;
+    
+    std::string test_file = "test_concurrent.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E0,2024-01-01,1.00,Food,Seed\n";
+    file.close();
+    
+    const int batches = 40, batchSize = 250;
+    std::atomic<bool> done(false);
+    std::atomic<int> inconsistent(0);
+    {
+        ConcurrentExpenseStore store(test_file);
+        
+        std::thread writer([&]() {
+            for (int b = 0; b < batches; b++) {
+                std::vector<Expense> batch;
+                for (int k = 0; k < batchSize; k++) {
+                    Expense e;
+                    e.id = "E" + std::to_string(b * batchSize + k + 1);
+                    e.date = k % 2 ? "2024-02-10" : "2024-03-05";
+                    e.amount = 1.00;
+                    e.category = k % 3 ? "Food" : "Transport";
+                    e.description = "Row";
+                    batch.push_back(e);
+                }
+                store.addExpenses(std::move(batch));
+            }
+            done = true;
+        });
+        
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; r++) {
+            readers.emplace_back([&]() {
+                uint64_t lastEpoch = 0;
+                do {
+                    ConcurrentExpenseStore::Snapshot snap = store.snapshot();
+                    size_t counted = 0;
+                    for (const CategoryStats &s : snap.statsByCategory()) counted += s.count;
+                    if (counted != snap.size() || snap.epoch() < lastEpoch) inconsistent++;
+                    lastEpoch = snap.epoch();
+                } while (!done);
+            });
+        }
+        writer.join();
+        for (auto &t : readers) t.join();
+        
+        ConcurrentExpenseStore::Snapshot snap = store.snapshot();
+        tf.run_test("Readers always see consistent versions", inconsistent == 0);
+        tf.run_test("Every batch is published", snap.size() == 1 + batches * batchSize);
+        tf.run_test("Date query spans segments and tail",
+                    snap.queryByDate("2024-02-01", "2024-02-28").size() == batches * batchSize / 2);
+        std::vector<Expense> top = snap.find(ExpenseQuery().inCategory("Food")
+                                                 .sortBy(ExpenseQuery::SortKey::Date).limit(3));
+        tf.run_test("Sort and limit across segments",
+                    top.size() == 3 && top[0].id == "E0" && top[1].date == "2024-02-10");
+        tf.run_test("Offset plus a huge limit spans every segment",
+                    snap.find(ExpenseQuery().offset(2).limit(SIZE_MAX - 1)).size() == batches * batchSize - 1);
+        
+        Expense e;
+        e.id = "E-last";
+        e.date = "2024-02-11";
+        e.amount = 2.00;
+        e.category = "Food";
+        store.addExpense(e);
+        ConcurrentExpenseStore::Snapshot next = store.snapshot();
+        tf.run_test("Reader picks up a newly published version",
+                    next.size() == snap.size() + 1 && next.epoch() == snap.epoch() + 1 &&
+                    store.snapshot().epoch() == next.epoch());
+    }
+    
+    ConcurrentExpenseStore reloaded(test_file);
+    tf.run_test("Concurrent writes are persisted", reloaded.size() == 2 + batches * batchSize);
+    
+    // One reader thread across stores that come and go
+    std::string other_file = "test_concurrent_other.csv";
+    std::remove((other_file + ".journal").c_str());
+    bool separate = true;
+    std::thread reader([&]() {
+        for (int round = 0; round < 3; round++) {
+            std::ofstream small(other_file);
+            small << "id,date,amount,category,description\n";
+            for (int k = 0; k <= round; k++) small << "O" << k << ",2024-01-01,1.00,Food,Row\n";
+            small.close();
+            ConcurrentExpenseStore temporary(other_file);
+            separate = separate && temporary.snapshot().size() == static_cast<size_t>(round + 1) &&
+                       reloaded.snapshot().size() == 2 + batches * batchSize;
+        }
+    });
+    reader.join();
+    tf.run_test("Reader slots are kept per store", separate);
+    std::remove(other_file.c_str());
+    std::remove((other_file + ".journal").c_str());
+    
+    // Clean up
+    reloaded.compact();
+    std::remove(test_file.c_str());
+}
+
+// Test the HTTP/JSON endpoints through the service handler
+void test_expense_service() {
+    TestFramework tf;
+    
+    std::string test_file = "test_service.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file.close();
+    
+    {
+        ConcurrentExpenseStore store(test_file);
+        ExpenseService service(store);
+        auto request = [&service](const std::string &method, const std::string &target,
+                                  const std::string &body = "") {
+            HttpRequest req;
+            req.method = method;
+            size_t q = target.find('?');
+            req.path = target.substr(0, q);
+            if (q != std::string::npos) HttpServer::parseQuery(target.substr(q + 1), req.query);
+            req.body = body;
+            return service.handle(req);
+        };
+        
+        HttpResponse added = request("POST", "/expenses",
+            "{\"id\":\"E1002\",\"date\":\"2024-01-20\",\"amount\":50.10,"
+            "\"category\":\"Transport\",\"description\":\"Gas, \\\"premium\\\"\"}");
+        tf.run_test("POST /expenses adds one", added.status == 201 && store.size() == 2);
+        
+        HttpResponse bulk = request("POST", "/expenses/bulk",
+            "[{\"date\":\"2024-02-01\",\"amount\":\"3.00\",\"category\":\"Food\"},"
+            " {\"date\":\"2024-02-02\",\"amount\":4,\"category\":\"Food\"}]");
+        tf.run_test("POST /expenses/bulk adds a batch",
+                    bulk.status == 201 && bulk.body == "{\"added\":2}\n" && store.size() == 4);
+        
+        tf.run_test("Invalid expense is rejected",
+                    request("POST", "/expenses", "{\"date\":\"2024-02-30\",\"amount\":1,"
+                                                 "\"category\":\"Food\"}").status == 400 &&
+                    store.size() == 4);
+        
+        HttpResponse list = request("GET", "/expenses?category=Transport");
+        tf.run_test("GET /expenses filters and escapes",
+                    list.status == 200 &&
+                    list.body == "[{\"id\":\"E1002\",\"date\":\"2024-01-20\",\"amount\":50.10,"
+                                 "\"category\":\"Transport\",\"description\":\"Gas, \\\"premium\\\"\"}]\n");
+        
+        HttpResponse page = request("GET", "/expenses?category=Food&sort=amount&limit=1");
+        tf.run_test("GET /expenses sorts and limits",
+                    page.body.find("\"amount\":3.00") != std::string::npos &&
+                    page.body.find("25.50") == std::string::npos);
+        
+        HttpResponse summary = request("GET", "/summary?from=2024-02-01&to=2024-02-28");
+        tf.run_test("GET /summary aggregates",
+                    summary.body == "[{\"category\":\"Food\",\"total\":7.00,\"count\":2,"
+                                    "\"min\":3.00,\"max\":4.00,\"average\":3.50}]\n");
+        
+        tf.run_test("Unknown path is 404", request("GET", "/nope").status == 404);
+        tf.run_test("Wrong method is 405", request("DELETE", "/summary").status == 405);
+        tf.run_test("Bulk array needs commas between expenses",
+                    request("POST", "/expenses/bulk",
+                            "[{\"date\":\"2024-02-03\",\"amount\":1,\"category\":\"Food\"}"
+                            " {\"date\":\"2024-02-04\",\"amount\":1,\"category\":\"Food\"}]").status == 400 &&
+                    store.size() == 4);
+        request("X\"}{" + std::string(300, 'M'), "/summary");
+        HttpResponse metrics = request("GET", "/metrics");
+        tf.run_test("GET /metrics reports latency",
+                    metrics.body.find("\"POST /expenses\":{\"requests\":2,\"errors\":1") != std::string::npos &&
+                    metrics.body.find("p99_us") != std::string::npos);
+        tf.run_test("Unknown methods share one metrics key",
+                    metrics.body.find("\"OTHER /summary\":{\"requests\":1") != std::string::npos &&
+                    metrics.body.find("MMMM") == std::string::npos && metrics.body.back() == '\n');
+    }
+    
+    ConcurrentExpenseStore reloaded(test_file);
+    tf.run_test("Service writes are persisted", reloaded.size() == 4);
+    
+    // Clean up
+    reloaded.compact();
+    std::remove(test_file.c_str());
+}
+
+// Test that a request followed by a half-close is still answered
+void test_http_half_close() {
+    TestFramework tf;
+    
+    HttpServer server([](const HttpRequest &req) {
+        HttpResponse r;
+        r.body = "{\"path\":" + HttpServer::jsonString(req.path) + "}";
+        return r;
+    });
+    tf.run_test("Server listens on a free port", server.listen(0));
+    std::thread loop([&server]() { server.run(1); });
+    
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.port());
+    std::string response;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+        std::string request = "GET /health HTTP/1.1\r\nHost: x\r\n\r\n";
+        send(fd, request.data(), static_cast<int>(request.size()), 0);
+#ifdef _WIN32
+        shutdown(fd, SD_SEND);
+#else
+        shutdown(fd, SHUT_WR);
+#endif
+        char buf[1024];
+        int n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) response.append(buf, static_cast<size_t>(n));
+    }
+    expense_close_socket(fd);
+    server.stop();
+    loop.join();
+    
+    tf.run_test("Buffered request answered after half-close",
+                response.compare(0, 15, "HTTP/1.1 200 OK") == 0 &&
+                response.find("{\"path\":\"/health\"}") != std::string::npos);
+}
+
+// Test arena-backed text storage
+void test_string_arena() {
+    TestFramework tf;
+    
+    StringArena arena(64);
+    const char *first = arena.store("E1", "Lunch");
+    std::string_view view(first, 7);
+    for (int i = 0; i < 100; i++) arena.store("E", "more text");
+    arena.store(std::string(200, 'x')); // larger than a slab
+    tf.run_test("Arena views survive later appends", view == "E1Lunch");
+    
+    size_t held = arena.capacity();
+    uint64_t gen = arena.generation();
+    arena.clear();
+    tf.run_test("Clear keeps slabs for reuse",
+                arena.size() == 0 && arena.capacity() == held && arena.generation() == gen + 1);
+    for (int i = 0; i < 100; i++) arena.store("E", "more text");
+    tf.run_test("Reuse after clear allocates nothing", arena.capacity() == held);
+    
+    ExpenseTable table;
+    table.append("E1", parseDate("2024-01-15"), Money(1), "Food", "Lunch");
+    std::string_view desc = table.description(0);
+    for (int i = 0; i < 50000; i++) table.append("E", parseDate("2024-01-16"), Money(2), "Food", "Row");
+    tf.run_test("Table views stay valid while appending", desc == "Lunch");
+    
+    ExpenseTable copy = table;
+    table.clear();
+    tf.run_test("Table copies own their text",
+                copy.size() == 50001 && copy.id(0) == "E1" && copy.description(0) == "Lunch");
+    
+    ExpenseTable merged;
+    merged.append("M1", parseDate("2024-01-01"), Money(3), "Rent", "First");
+    ExpenseTable part;
+    part.append("P1", parseDate("2024-01-02"), Money(4), "Food", "Moved");
+    std::string_view moved = part.description(0);
+    merged.appendTable(std::move(part));
+    tf.run_test("Moved tables hand over their text",
+                merged.size() == 2 && merged.description(1) == "Moved" &&
+                merged.description(1).data() == moved.data() && part.empty() &&
+                merged.categoryName(merged.categoryCode(1)) == "Food");
+}
+
+// Test id generation and the id index
+void test_id_index() {
+    TestFramework tf;
+    
+    std::string test_file = "test_ids.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1001,2024-01-15,25.50,Food,Lunch\n";
+    file << "E510041,2024-01-16,5.00,Food,Coffee\n";
+    file << "E1001,2024-01-17,9.99,Food,Duplicate\n";
+    file << "X-7,2024-01-18,1.00,Misc,Foreign id\n";
+    file.close();
+    
+    ExpenseStore store(test_file);
+    Expense found;
+    tf.run_test("Lookup by id", store.findById("X-7", found) && found.amount == Money(1.00));
+    tf.run_test("Duplicate id resolves to the first row",
+                store.findById("E1001", found) && found.description == "Lunch");
+    tf.run_test("Missing id is not found", !store.findById("E42", found));
+    
+    std::string id1 = store.nextId(), id2 = store.nextId();
+    tf.run_test("Generated ids follow the highest loaded id", id1 == "E510042" && id2 == "E510043");
+    
+    Expense e;
+    e.id = "E1001";
+    e.date = "2024-02-01";
+    e.amount = 3.00;
+    e.category = "Food";
+    tf.run_test("Duplicate add is rejected", !store.addExpense(e) && store.size() == 4);
+    
+    std::vector<Expense> batch(3, e);
+    batch[0].id = "B1";
+    batch[1].id = "B1";
+    batch[2].id = "B2";
+    tf.run_test("Bulk add skips taken ids", store.addExpenses(std::move(batch)) == 2 && store.size() == 6);
+    tf.run_test("Bulk rows are indexed", store.containsId("B2"));
+    
+    // Many ids from several threads stay unique
+    IdGenerator gen;
+    gen.observe("E99");
+    std::vector<std::vector<std::string>> issued(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&gen, &issued, t]() {
+            for (int k = 0; k < 5000; k++) issued[t].push_back(gen.generate());
+        });
+    }
+    for (auto &t : threads) t.join();
+    std::unordered_set<std::string> unique;
+    for (const auto &v : issued) unique.insert(v.begin(), v.end());
+    tf.run_test("Concurrent ids are unique", unique.size() == 20000 && !unique.count("E99"));
+    
+    // Index stays correct through growth and deletes
+    ExpenseTable table;
+    IdIndex index;
+    for (int i = 0; i < 3000; i++) {
+        table.append("R" + std::to_string(i), 0, Money(1), "Misc", "");
+        index.insert(table, static_cast<uint32_t>(i));
+    }
+    bool ok = index.size() == 3000;
+    for (int i = 0; i < 3000; i += 2) ok = ok && index.erase(table, "R" + std::to_string(i));
+    for (int i = 0; i < 3000; i++) {
+        uint32_t row = index.find(table, "R" + std::to_string(i));
+        ok = ok && (i % 2 ? row == static_cast<uint32_t>(i) : row == IdIndex::kNotFound);
+    }
+    tf.run_test("Index survives growth and erase", ok && index.size() == 1500);
+    
+    // Clean up
+    store.compact();
+    std::remove(test_file.c_str());
+}
+
+// Test updates and deletes through tombstones and the journal
+void test_update_delete() {
+    TestFramework tf;
+    
+    std::string test_file = "test_tombstones.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream file(test_file);
+    file << "id,date,amount,category,description\n";
+    file << "E1,2024-01-15,25.50,Food,Lunch\n";
+    file << "E2,2024-01-16,800.00,Rent,Flat\n";
+    file << "E3,2024-02-01,4.50,Food,Coffee\n";
+    file.close();
+    
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal();
+        Expense e;
+        store.findById("E1", e);
+        e.amount = 30.00;
+        tf.run_test("Update existing expense", store.updateExpense(e));
+        tf.run_test("Delete existing expense", store.deleteExpense("E2"));
+        tf.run_test("Delete missing expense fails", !store.deleteExpense("E2"));
+        e.id = "E9";
+        tf.run_test("Update missing expense fails", !store.updateExpense(e));
+        
+        tf.run_test("Size counts live rows", store.size() == 2 && store.deadRows() == 2);
+        tf.run_test("Deleted id is free again", !store.containsId("E2"));
+        tf.run_test("Query skips dead rows", store.find(ExpenseQuery()).size() == 2);
+        std::vector<CategoryStats> stats = store.statsByCategory();
+        tf.run_test("Summary skips dead rows", stats.size() == 1 && stats[0].category == "Food" &&
+                    stats[0].total == Money(34.50) && stats[0].count == 2);
+        std::ostringstream printed;
+        std::streambuf *saved = std::cout.rdbuf(printed.rdbuf());
+        store.summarizeByCategory();
+        std::cout.rdbuf(saved);
+        tf.run_test("Printed summary skips emptied category",
+                    printed.str().find("Rent") == std::string::npos &&
+                    printed.str().find("Total: $34.50") != std::string::npos);
+        std::vector<CategoryTotal> totals = store.summarizeRange("2024-01-01", "2024-01-31");
+        tf.run_test("Rollups see the update", totals.size() == 1 && totals[0].total == Money(30.00));
+        tf.run_test("Range stats skip dead rows",
+                    store.statsInRange("2024-01-01", "2024-12-31").total == Money(34.50));
+        tf.run_test("Mutations are journaled, not saved", store.journalRecords() == 2);
+    }
+    
+    // Replaying the journal gives the same state without dead rows
+    {
+        ExpenseStore store(test_file);
+        Expense e;
+        tf.run_test("Replay applies updates and deletes", store.size() == 2 && store.deadRows() == 0 &&
+                    store.findById("E1", e) && e.amount == Money(30.00) && !store.containsId("E2"));
+        tf.run_test("Updated expense moves to the end", store.at(1).id == "E1");
+        std::ostringstream printed;
+        std::streambuf *saved = std::cout.rdbuf(printed.rdbuf());
+        store.summarizeByCategory();
+        std::cout.rdbuf(saved);
+        tf.run_test("Replayed summary skips emptied category", printed.str().find("Rent") == std::string::npos);
+        store.compact();
+    }
+    std::ifstream in(test_file);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    tf.run_test("Compaction writes only live rows",
+                content.find("E2") == std::string::npos && content.find("30.00") != std::string::npos);
+    
+    // Compaction starts on its own once enough rows are dead
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal();
+        store.setCompactionRatio(0.5, 2);
+        store.deleteExpense("E1");
+        tf.run_test("One dead row stays in the journal", store.deadRows() == 1 && store.journalRecords() == 1);
+        Expense e;
+        e.id = "E4";
+        e.date = "2024-03-01";
+        e.amount = 1.00;
+        e.category = "Misc";
+        store.addExpense(e);
+        store.deleteExpense("E4");
+        tf.run_test("Dead ratio triggers compaction", store.deadRows() == 0 && store.journalRecords() == 0 &&
+                    store.size() == 1);
+    }
+    
+    // Rows sharing an id can each be found and deleted in turn, also after
+    // compaction rebuilt the index
+    std::ofstream dup(test_file);
+    dup << "id,date,amount,category,description\n";
+    dup << "D1,2024-01-01,1.00,Food,First\n";
+    dup << "D2,2024-01-02,2.00,Food,Other\n";
+    dup << "D1,2024-01-03,3.00,Food,Second\n";
+    dup << "D1,2024-01-04,4.00,Food,Third\n";
+    dup.close();
+    {
+        ExpenseStore store(test_file);
+        store.enableJournal();
+        Expense e;
+        store.deleteExpense("D1");
+        tf.run_test("Deleting a duplicate id reveals the next row",
+                    store.findById("D1", e) && e.description == "Second");
+        store.compact();
+        tf.run_test("Duplicate still found after compaction",
+                    store.findById("D1", e) && e.description == "Second");
+        store.deleteExpense("D1");
+        tf.run_test("Every duplicate can be deleted",
+                    store.findById("D1", e) && e.description == "Third" && store.deleteExpense("D1") &&
+                    !store.containsId("D1") && store.size() == 1);
+    }
+    
+    // Without the journal a batch of deletes is saved with one rewrite
+    dup.open(test_file);
+    dup << "id,date,amount,category,description\n";
+    dup << "B1,2024-01-01,1.00,Food,One\nB2,2024-01-02,2.00,Food,Two\nB3,2024-01-03,3.00,Food,Three\n";
+    dup.close();
+    {
+        ExpenseStore store(test_file);
+        tf.run_test("Batch delete counts found ids",
+                    store.deleteExpenses({"B1", "B3", "B9"}) == 2 && store.size() == 1);
+    }
+    ExpenseStore afterBatch(test_file);
+    tf.run_test("Batch delete is saved", afterBatch.size() == 1 && afterBatch.at(0).id == "B2");
+    
+    ExpenseTable table;
+    for (int i = 0; i < 6; i++) table.append("R" + std::to_string(i), i, Money(i), i % 2 ? "Odd" : "Even", "");
+    table.kill(0);
+    table.kill(3);
+    table.kill(4);
+    ExpenseTable copy = table;
+    table.removeDead();
+    tf.run_test("Copies keep tombstones", copy.deadCount() == 3 && !copy.isLive(3) && copy.isLive(5));
+    tf.run_test("removeDead keeps live rows in order", table.size() == 3 && table.deadCount() == 0 &&
+                table.id(0) == "R1" && table.id(1) == "R2" && table.id(2) == "R5");
+    
+    // Clean up
+    std::remove(test_file.c_str());
+    std::remove((test_file + ".journal").c_str());
+}
+
+// Test the shared date parser and validator
+void test_date_validation() {
+    TestFramework tf;
+    
+    tf.run_test("Parse epoch and leap day", parseDate("1970-01-01") == 0 &&
+                parseDate("2000-02-29") == daysFromCivil(2000, 2, 29));
+    tf.run_test("Reject impossible dates", parseDate("1900-02-29") == kNoDate &&
+                parseDate("2024-04-31") == kNoDate && parseDate("2024-00-10") == kNoDate &&
+                parseDate("2024-01-00") == kNoDate);
+    tf.run_test("Reject malformed dates", parseDate("2024/01/15") == kNoDate &&
+                parseDate("2024-1-5") == kNoDate && parseDate("2024-01-1x") == kNoDate &&
+                parseDate("") == kNoDate && parseDate("\xb2""024-01-15") == kNoDate);
+    
+    DateValidator dates(parseDate("2024-06-30"));
+    tf.run_test("Accept up to today", dates.accepts("2024-06-30") && dates.accepts("1900-01-01"));
+    tf.run_test("Reject future and out-of-range dates", !dates.accepts("2024-07-01") &&
+                !dates.accepts("1899-12-31") && !dates.accepts("not a date"));
+    tf.run_test("Today comes from the clock", isValidDate(formatDate(localToday())) &&
+                !isValidDate(formatDate(localToday() + 2)));
+    
+    // Import skips rows the validator rejects; load keeps them
+    std::string test_file = "test_dates.csv", import_file = "test_dates_import.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream(test_file) << "id,date,amount,category,description\n"
+                             << "E1,1850-01-01,1.00,Misc,Old ledger row\n";
+    std::ofstream(import_file) << "id,date,amount,category,description\n"
+                               << "E2,2024-01-15,2.00,Food,Valid\n"
+                               << "E3,2999-01-01,3.00,Food,Future\n"
+                               << "E4,2024-02-30,4.00,Food,Impossible\n"
+                               << "E5,,5.00,Food,Missing\n";
+    ExpenseStore store(test_file);
+    store.enableJournal();
+    tf.run_test("Load keeps out-of-range dates", store.size() == 1);
+    tf.run_test("Import skips invalid dates", store.importCsv(import_file) == 1 &&
+                store.containsId("E2") && !store.containsId("E3"));
+    std::istringstream in("id,date,amount,category,description\nE6,2024-03-01,6.00,Food,Ok\nE7,2024-3-1,7.00,Food,Bad\n");
+    tf.run_test("Stream import skips invalid dates", store.importCsv(in) == 1 && store.containsId("E6"));
+    
+    // Clean up
+    std::remove(test_file.c_str());
+    std::remove(import_file.c_str());
+    std::remove((test_file + ".journal").c_str());
+}
+
+// Test full-text search through the inverted index
+void test_text_search() {
+    TestFramework tf;
+    
+    std::vector<std::string> seen;
+    forEachWord("Uber-Eats: DINNER x2, café", [&seen](std::string_view w) { seen.emplace_back(w); });
+    tf.run_test("Words are split and lower-cased",
+                seen == std::vector<std::string>({"uber", "eats", "dinner", "x2", "café"}));
+    std::vector<TextTerm> terms = parseTextTerms("Uber air*");
+    tf.run_test("Trailing star makes a prefix term", terms.size() == 2 && terms[0].word == "uber" &&
+                !terms[0].prefix && terms[1].word == "air" && terms[1].prefix);
+    
+    std::string test_file = "test_search.csv";
+    std::remove((test_file + ".journal").c_str());
+    std::ofstream(test_file) << "id,date,amount,category,description\n"
+                             << "E1,2024-01-05,35.00,Travel,Uber to airport\n"
+                             << "E2,2024-01-06,22.50,Food,Uber Eats dinner\n"
+                             << "E3,2024-02-07,48.00,Travel,Taxi to Airport\n"
+                             << "E4,2024-02-08,4.20,Food,Coffee\n"
+                             << "E5,2024-03-09,61.30,Food,Groceries at Aldi\n";
+    ExpenseStore store(test_file);
+    store.enableJournal();
+    tf.run_test("Single word", store.find(ExpenseQuery().search("UBER")).size() == 2);
+    tf.run_test("All words", store.find(ExpenseQuery().search("uber airport")).size() == 1);
+    tf.run_test("Any word", store.find(ExpenseQuery().search("uber taxi", true)).size() == 3);
+    tf.run_test("Prefix word", store.find(ExpenseQuery().search("air*")).size() == 2);
+    tf.run_test("Whole words only", store.find(ExpenseQuery().search("air")).empty());
+    QueryResult travel = store.find(ExpenseQuery().search("airport").inCategory("Travel")
+                                        .between("2024-02-01", "2024-02-29"));
+    tf.run_test("Combined with category and date", travel.size() == 1 && travel[0].id() == "E3");
+    std::vector<CategoryStats> stats = store.summarize(ExpenseQuery().search("uber"));
+    tf.run_test("Summaries use the search", stats.size() == 2 && stats[0].category == "Food" &&
+                stats[0].total == Money(22.50));
+    
+    Expense e;
+    e.id = "E6";
+    e.date = "2024-03-10";
+    e.amount = 18.00;
+    e.category = "Travel";
+    e.description = "Uber home";
+    store.addExpense(e);
+    store.deleteExpense("E1");
+    QueryResult uber = store.find(ExpenseQuery().search("uber"));
+    tf.run_test("Index follows adds and deletes", uber.size() == 2 && uber[0].id() == "E2" &&
+                uber[1].id() == "E6");
+    
+    // The scan fallback (no index) agrees with the index
+    ExpenseQuery q = ExpenseQuery().search("to uber taxi", true).sortBy(ExpenseQuery::SortKey::Id);
+    tf.run_test("Scan and index agree", q.select(store.columns()) == store.find(q).rows());
+    
+    // Long gaps between rows take multi-byte varints
+    ExpenseTable table;
+    for (int i = 0; i < 5000; i++)
+        table.append("R" + std::to_string(i), 0, Money(1), "Misc", i % 700 == 0 ? "rare event" : "common");
+    TextIndex index;
+    index.build(table);
+    std::vector<uint32_t> rare = index.lookup(parseTextTerms("rare"));
+    bool ok = rare.size() == 8;
+    for (size_t k = 0; ok && k < rare.size(); k++) ok = rare[k] == k * 700;
+    tf.run_test("Posting lists decode large gaps", ok && index.lookup(parseTextTerms("common")).size() == 4992);
+    
+    // Clean up
+    store.compact();
+    std::remove(test_file.c_str());
+}
+
 // Test amount precision
+void test_segmented_storage() {
+    TestFramework tf;
+    
+    SegmentManifest quarters("unused", 3);
+    tf.run_test("Period starts at its first month",
+                quarters.periodOf(parseDate("2024-05-10")) == parseDate("2024-04-01"));
+    tf.run_test("Period ends before the next one",
+                quarters.periodEnd(parseDate("2024-04-01")) == parseDate("2024-06-30"));
+    tf.run_test("Undated rows get their own period", quarters.periodOf(kNoDate) == kNoDate);
+    
+    std::string dir = "test_segments";
+    std::string today = formatDate(localToday());
+    auto segmentOf = [](const ExpenseStore &store, const std::string &date) {
+        const SegmentManifest &m = store.segmentManifest();
+        for (const SegmentInfo &s : m.all()) {
+            if (s.period == m.periodOf(parseDate(date))) return s;
+        }
+        return SegmentInfo();
+    };
+    auto expense = [](const std::string &id, const std::string &date, double amount) {
+        Expense e;
+        e.id = id;
+        e.date = date;
+        e.amount = amount;
+        e.category = "Food";
+        e.description = "Meal";
+        return e;
+    };
+    
+    {
+        StoreOptions options;
+        options.segmentMonths = 1;
+        ExpenseStore store(dir, options);
+        store.addExpense(expense("S1", "2024-01-15", 10.00));
+        store.addExpense(expense("S2", "2024-01-20", 20.00));
+        store.addExpense(expense("S3", "2024-02-03", 30.00));
+        store.addExpense(expense("S4", today, 40.00));
+        tf.run_test("One segment per month", store.isSegmented() && store.segmentManifest().size() == 3);
+        
+        store.addExpense(expense("S5", today, 50.00));
+        SegmentInfo open = segmentOf(store, today);
+        tf.run_test("Open segment is appended in place", open.generation == 0 && open.rows == 2);
+        
+        SegmentInfo feb = segmentOf(store, "2024-02-03");
+        SegmentInfo before = segmentOf(store, "2024-01-01");
+        store.addExpense(expense("S6", "2024-01-25", 60.00));
+        SegmentInfo jan = segmentOf(store, "2024-01-01");
+        tf.run_test("Sealed segment is rewritten as a new file",
+                    jan.generation == before.generation + 1 && jan.rows == 3 && jan.file != before.file);
+        tf.run_test("Old generation is removed", !std::ifstream(dir + "/" + before.file).is_open());
+        tf.run_test("Other segments are untouched", segmentOf(store, "2024-02-03").file == feb.file);
+        
+        store.deleteExpense("S3");
+        tf.run_test("Emptied segment is dropped", store.segmentManifest().size() == 2);
+    }
+    
+    {
+        ExpenseStore store(dir);
+        tf.run_test("Manifest is found without options", store.isSegmented() && store.size() == 5);
+        tf.run_test("Range query across segments", store.queryByDate("2024-01-01", "2024-01-31").size() == 3);
+        tf.run_test("Only overlapping segments are listed",
+                    store.segmentManifest().overlapping(parseDate("2024-01-21"), parseDate("2024-02-28")).size() == 1);
+        
+        // Journaled changes reach the segments at compaction
+        store.enableJournal();
+        store.deleteExpense("S1");
+        store.compact();
+    }
+    {
+        ExpenseStore store(dir);
+        tf.run_test("Compaction folds the journal into segments",
+                    store.size() == 4 && !store.containsId("S1") && segmentOf(store, "2024-01-01").rows == 2);
+        for (const SegmentInfo &s : store.segmentManifest().all())
+            std::remove(store.segmentManifest().pathOf(s).c_str());
+    }
+    std::remove(SegmentManifest::manifestPath(dir).c_str());
+    std::remove(dir.c_str());
+}
+
+void test_columnar_segment() {
+    TestFramework tf;
+    
+    // Three blocks: sequential ids, then a block with free-form ids
+    ExpenseTable table;
+    int32_t first = parseDate("2024-01-01");
+    size_t rows = ColumnarSegment::kBlockRows * 2 + 100;
+    const char *categories[] = {"Food", "Rent", "Travel"};
+    for (size_t i = 0; i < rows; i++) {
+        std::string id = i < ColumnarSegment::kBlockRows * 2 ? "E" + std::to_string(1000 + i) : "ref-" + std::to_string(i) + "x";
+        int64_t cents = static_cast<int64_t>((i * 7919) % 100000) - (i % 50 == 0 ? 250000 : 0);
+        table.append(id, first + static_cast<int32_t>(i / 100), Money::fromUnits(cents),
+                     categories[(i / 40) % 3], i % 3 ? "Lunch, with \"team\"" : "Caf\xc3\xa9 " + std::to_string(i));
+    }
+    table.append("E9999999999", kNoDate, Money(1.00), "Food", "");
+    std::vector<uint32_t> all(table.size());
+    for (uint32_t i = 0; i < all.size(); i++) all[i] = i;
+    
+    std::string path = "test_columnar.col";
+    tf.run_test("Columnar segment is written", ColumnarSegment::write(table, all, path));
+    std::string csv;
+    for (size_t i = 0; i < table.size(); i++) {
+        table.formatCsvRow(i, csv);
+        csv += '\n';
+    }
+    {
+        MappedFile mapped(path);
+        tf.run_test("Columnar segment is smaller than CSV", mapped.isOpen() && mapped.size() < csv.size() / 2);
+    }
+    
+    ExpenseTable back;
+    back.append("X1", first, Money(2.00), "Other", "Already here");
+    bool read = ColumnarSegment::read(back, path);
+    bool same = read && back.size() == table.size() + 1;
+    std::string a, b;
+    for (size_t i = 0; same && i < table.size(); i++) {
+        a.clear();
+        b.clear();
+        table.formatCsvRow(i, a);
+        back.formatCsvRow(i + 1, b);
+        same = a == b;
+    }
+    tf.run_test("Columnar round trip keeps every field", same);
+    
+    // Blocks outside the date range are skipped, the rest decoded
+    ColumnarSegment::Filter filter;
+    filter.from = first + 50;
+    filter.to = first + 60;
+    size_t blocks = 0, matched = 0;
+    bool scanned = ColumnarSegment::scan(path, filter, [&](const ExpenseTable &block) {
+        blocks++;
+        for (size_t i = 0; i < block.size(); i++) matched += block.day(i) >= filter.from && block.day(i) <= filter.to;
+    });
+    tf.run_test("Date filter skips blocks", scanned && blocks == 1 && matched == 1100);
+    filter = ColumnarSegment::Filter();
+    filter.minAmount = 200000;
+    blocks = 0;
+    ColumnarSegment::scan(path, filter, [&](const ExpenseTable &) { blocks++; });
+    tf.run_test("Amount filter skips blocks", blocks == 0);
+    
+    // A damaged block is caught by its checksum
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(static_cast<std::streamoff>(sizeof(ColumnarSegment::Header) + 64));
+        f.put('\x7f');
+    }
+    ExpenseTable damaged;
+    tf.run_test("Corrupt block is rejected", !ColumnarSegment::read(damaged, path) && damaged.size() == 0);
+    std::remove(path.c_str());
+    
+    // Sealed segments of a store are compressed at compaction
+    std::string dir = "test_columnar_store";
+    std::string today = formatDate(localToday());
+    {
+        StoreOptions options;
+        options.segmentMonths = 1;
+        ExpenseStore store(dir, options);
+        std::vector<Expense> batch;
+        for (int i = 0; i < 3; i++) {
+            Expense e;
+            e.id = store.nextId();
+            e.date = i < 2 ? "2024-0" + std::to_string(i + 1) + "-15" : today;
+            e.amount = 10.0 * (i + 1);
+            e.category = "Food";
+            e.description = "Meal";
+            batch.push_back(e);
+        }
+        store.addExpenses(std::move(batch));
+    }
+    {
+        StoreOptions options;
+        options.columnar = true;
+        ExpenseStore store(dir, options);
+        store.compact();
+        size_t cold = 0, open = 0;
+        for (const SegmentInfo &s : store.segmentManifest().all())
+            (SegmentManifest::isColumnar(s.file) ? cold : open)++;
+        tf.run_test("Sealed segments become columnar", cold == 2 && open == 1);
+    }
+    {
+        ExpenseStore store(dir);
+        tf.run_test("Columnar segments load", store.size() == 3 &&
+                    store.queryByDate("2024-02-01", "2024-02-29").size() == 1);
+        Expense e;
+        e.id = store.nextId();
+        e.date = "2024-02-20";
+        e.amount = 5.00;
+        e.category = "Rent";
+        e.description = "Late";
+        store.addExpense(e);
+        tf.run_test("Columnar segment takes a back-dated add", store.queryByDate("2024-02-01", "2024-02-29").size() == 2);
+        for (const SegmentInfo &s : store.segmentManifest().all())
+            std::remove(store.segmentManifest().pathOf(s).c_str());
+    }
+    std::remove(SegmentManifest::manifestPath(dir).c_str());
+    std::remove(dir.c_str());
+}
+
 void test_amount_precision() {
     TestFramework tf;
     
@@ -218,6 +1680,29 @@ int main() {
     test_csv_parsing_with_commas();
     test_error_handling();
     test_amount_precision();
+    test_money_type();
+    test_loader_edge_cases();
+    test_parallel_load();
+    test_columnar_storage();
+    test_rollup_cache();
+    test_aggregation_kernels();
+    test_category_dictionary();
+    test_binary_snapshot();
+    test_bulk_import();
+    test_journal_mode();
+    test_stream_query();
+    test_query_builder();
+    test_expense_writer();
+    test_concurrent_store();
+    test_expense_service();
+    test_http_half_close();
+    test_string_arena();
+    test_id_index();
+    test_update_delete();
+    test_date_validation();
+    test_text_search();
+    test_segmented_storage();
+    test_columnar_segment();
     
     std::cout << "\n=== ExpenseStore Tests Completed ===" << std::endl;
     